@@ -0,0 +1,103 @@
+#include "bioniceye.h"
+
+#include <new>
+
+#include "simulator.h"
+
+using namespace std;
+
+static_assert(static_cast<int>(BIONIC_EYE_GRAY8) == PIXEL_GRAY8 && static_cast<int>(BIONIC_EYE_BGR24) == PIXEL_BGR24
+              && static_cast<int>(BIONIC_EYE_BGRA32) == PIXEL_BGRA32 && static_cast<int>(BIONIC_EYE_YUYV) == PIXEL_YUYV
+              && static_cast<int>(BIONIC_EYE_NV12) == PIXEL_NV12, "The C formats must be the PixelFormat values");
+
+struct bionic_eye {
+    Simulator simulator;
+};
+
+bionic_eye* bionic_eye_create(void) {
+    try {
+        return new(nothrow) bionic_eye;
+    } catch(...) {
+        return nullptr;
+    }
+}
+
+void bionic_eye_destroy(bionic_eye* context) {
+    delete context;
+}
+
+int bionic_eye_set_grid(bionic_eye* context, int electrodes_w, int electrodes_h) {
+    if(!context || electrodes_w <= 0 || electrodes_h <= 0) {
+        return BIONIC_EYE_INVALID;
+    }
+    context->simulator.setGrid(electrodes_w, electrodes_h);
+    return BIONIC_EYE_OK;
+}
+
+int bionic_eye_set_angle(bionic_eye* context, int angle) {
+    if(!context || angle <= 0 || angle > 100) {
+        return BIONIC_EYE_INVALID;
+    }
+    context->simulator.setAngle(angle);
+    return BIONIC_EYE_OK;
+}
+
+int bionic_eye_set_smoothing(bionic_eye* context, int alpha) {
+    if(!context || alpha < 0 || alpha > 256) {
+        return BIONIC_EYE_INVALID;
+    }
+    context->simulator.setSmoothing(alpha);
+    return BIONIC_EYE_OK;
+}
+
+int bionic_eye_set_spread(bionic_eye* context, double sigma) {
+    if(!context || sigma < 0) {
+        return BIONIC_EYE_INVALID;
+    }
+    try {
+        context->simulator.setSpread(sigma);
+    } catch(...) {
+        return BIONIC_EYE_FAILED;
+    }
+    return BIONIC_EYE_OK;
+}
+
+int bionic_eye_set_reverse(bionic_eye* context, int reverse) {
+    if(!context) {
+        return BIONIC_EYE_INVALID;
+    }
+    context->simulator.setReverse(reverse != 0);
+    return BIONIC_EYE_OK;
+}
+
+int bionic_eye_output_size(const bionic_eye* context, int width, int height, int* electrodes_w, int* electrodes_h) {
+    if(!context || width <= 0 || height <= 0 || !electrodes_w || !electrodes_h) {
+        return BIONIC_EYE_INVALID;
+    }
+    cv::Size const size(context->simulator.outputSize(width, height));
+    *electrodes_w = size.width;
+    *electrodes_h = size.height;
+    return BIONIC_EYE_OK;
+}
+
+int bionic_eye_process(bionic_eye* context, const bionic_eye_frame* frame, bionic_eye_electrodes* electrodes) {
+    if(!context || !frame || !electrodes || frame->format < BIONIC_EYE_GRAY8 || frame->format > BIONIC_EYE_NV12) {
+        return BIONIC_EYE_INVALID;
+    }
+
+    FrameView const in = {frame->data, frame->width, frame->height, frame->stride, static_cast<PixelFormat>(frame->format)};
+    ElectrodeView const out = {electrodes->data, electrodes->width, electrodes->height, electrodes->stride};
+    if(frame->width > 0 && frame->height > 0) {
+        cv::Size const size(context->simulator.outputSize(frame->width, frame->height));
+        if(size.width != out.width || size.height != out.height) {
+            return BIONIC_EYE_SIZE;
+        }
+    }
+
+    //OpenCV reports its errors with exceptions, they must not cross the C interface
+    try {
+        return context->simulator.process(in, out) ? BIONIC_EYE_OK : BIONIC_EYE_INVALID;
+    } catch(...) {
+        return BIONIC_EYE_FAILED;
+    }
+}
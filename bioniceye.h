@@ -0,0 +1,78 @@
+#ifndef BIONICEYE_H_INCLUDED
+#define BIONICEYE_H_INCLUDED
+
+/*C interface of the simulation library, for the host processes which are not in C++
+  or not built with our compiler. Only plain types cross it, no exception goes out of it.*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  ifdef BIONIC_EYE_BUILD
+#    define BIONIC_EYE_API __declspec(dllexport)
+#  else
+#    define BIONIC_EYE_API __declspec(dllimport)
+#  endif
+#else
+#  define BIONIC_EYE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct bionic_eye bionic_eye;
+
+/*Same values as PixelFormat*/
+enum {
+    BIONIC_EYE_GRAY8 = 0,
+    BIONIC_EYE_BGR24 = 1,
+    BIONIC_EYE_BGRA32 = 2,
+    BIONIC_EYE_YUYV = 3,
+    BIONIC_EYE_NV12 = 4 /*data : the Y plane*/
+};
+
+enum {
+    BIONIC_EYE_OK = 0,
+    BIONIC_EYE_INVALID = -1, /*Null handle or view, or a stride shorter than a row*/
+    BIONIC_EYE_SIZE = -2,    /*The electrode buffer is not bionic_eye_output_size() of the frame*/
+    BIONIC_EYE_FAILED = -3
+};
+
+/*Frame in the memory of the caller (a DMA buffer of the camera for instance), read in place*/
+typedef struct {
+    const uint8_t* data;
+    int width;
+    int height;
+    size_t stride;
+    int format;
+} bionic_eye_frame;
+
+/*Electrodes written straight into the memory of the caller, one byte each*/
+typedef struct {
+    uint8_t* data;
+    int width;
+    int height;
+    size_t stride;
+} bionic_eye_electrodes;
+
+/*NULL if out of memory. One context per thread.*/
+BIONIC_EYE_API bionic_eye* bionic_eye_create(void);
+BIONIC_EYE_API void bionic_eye_destroy(bionic_eye* context);
+
+BIONIC_EYE_API int bionic_eye_set_grid(bionic_eye* context, int electrodes_w, int electrodes_h);
+BIONIC_EYE_API int bionic_eye_set_angle(bionic_eye* context, int angle);
+BIONIC_EYE_API int bionic_eye_set_smoothing(bionic_eye* context, int alpha);
+BIONIC_EYE_API int bionic_eye_set_spread(bionic_eye* context, double sigma);
+BIONIC_EYE_API int bionic_eye_set_reverse(bionic_eye* context, int reverse);
+
+/*Size the electrode buffer must have for a width x height frame*/
+BIONIC_EYE_API int bionic_eye_output_size(const bionic_eye* context, int width, int height, int* electrodes_w, int* electrodes_h);
+
+BIONIC_EYE_API int bionic_eye_process(bionic_eye* context, const bionic_eye_frame* frame, bionic_eye_electrodes* electrodes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BIONICEYE_H_INCLUDED */
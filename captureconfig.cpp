@@ -0,0 +1,121 @@
+#include "captureconfig.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "timing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+//Modes almost every UVC webcam offers, smallest first
+Size const usualModes[] = {
+    Size(160, 120),
+    Size(176, 144),
+    Size(320, 240),
+    Size(352, 288),
+    Size(640, 480),
+    Size(800, 600),
+    Size(1280, 720),
+    Size(1920, 1080)
+};
+
+//Above this, YUYV at 30 fps no longer fits in USB 2
+int const maxYuyvPixels = 640 * 480;
+
+string fourccName(int fourcc) {
+    string name(4, ' ');
+    for(int i(0); i < 4; ++i) {
+        name[i] = static_cast<char>((fourcc >> (8 * i)) & 0xFF);
+    }
+    return name;
+}
+
+}
+
+Size requiredResolution(int angle, int electrodes_w, int electrodes_h, int pixelsPerElectrode) {
+    electrodes_w = max(electrodes_w, 1);
+    electrodes_h = max(electrodes_h, 1);
+    pixelsPerElectrode = max(pixelsPerElectrode, 1);
+
+    //reduceImage() keeps the whole frame when angle is 0
+    if(angle <= 0) {
+        angle = 100;
+    }
+
+    //The crop keeps angle % of the width, and its height comes from the ratio of the electrodes
+    //(clamped to the frame height, which then has to hold the electrodes on its own)
+    int width((electrodes_w * pixelsPerElectrode * 100 + angle - 1) / angle),
+        height(electrodes_h * pixelsPerElectrode);
+
+    return Size(width, height);
+}
+
+CaptureMode chooseCaptureMode(Size const& required, bool uncompressed) {
+    Size chosen(usualModes[sizeof(usualModes) / sizeof(usualModes[0]) - 1]);
+    for(Size const& mode : usualModes) {
+        if(mode.width >= required.width && mode.height >= required.height) {
+            chosen = mode;
+            break;
+        }
+    }
+
+    CaptureMode mode;
+    mode.width = chosen.width;
+    mode.height = chosen.height;
+    mode.fourcc = uncompressed || chosen.area() <= maxYuyvPixels ? VideoWriter::fourcc('Y', 'U', 'Y', 'V') : VideoWriter::fourcc('M', 'J', 'P', 'G');
+    return mode;
+}
+
+CaptureNegotiator::CaptureNegotiator(VideoCapture& camera, int pixelsPerElectrode)
+    : m_camera(camera), m_pixelsPerElectrode(pixelsPerElectrode), m_uncompressed(false), m_lastChangeNs(0) {
+    m_mode.width = 0;
+    m_mode.height = 0;
+    m_mode.fourcc = 0;
+}
+
+bool CaptureNegotiator::update(int angle, int electrodes_w, int electrodes_h, int minimumDelayMs) {
+    uint64_t now(monotonicNs());
+    if(m_mode.width != 0 && now - m_lastChangeNs < static_cast<uint64_t>(minimumDelayMs) * 1000000) {
+        return false;
+    }
+
+    Size required(requiredResolution(angle, electrodes_w, electrodes_h, m_pixelsPerElectrode));
+    CaptureMode wanted(chooseCaptureMode(required, m_uncompressed));
+
+    //Hysteresis : keep a mode which is big enough unless a mode of half its size would do
+    bool tooSmall(m_mode.width < required.width || m_mode.height < required.height);
+    bool tooBig(wanted.width * wanted.height * 2 <= m_mode.width * m_mode.height);
+    if(m_mode.width != 0 && !tooSmall && !tooBig) {
+        return false;
+    }
+    if(wanted.width == m_mode.width && wanted.height == m_mode.height && wanted.fourcc == m_mode.fourcc) {
+        return false;
+    }
+
+    //The camera may refuse the format, the size is what matters
+    m_camera.set(CAP_PROP_FOURCC, wanted.fourcc);
+    m_camera.set(CAP_PROP_FRAME_WIDTH, wanted.width);
+    m_camera.set(CAP_PROP_FRAME_HEIGHT, wanted.height);
+    m_mode = wanted;
+    m_lastChangeNs = now;
+
+    Size actual(actualSize());
+    cout << "Camera : " << wanted.width << " x " << wanted.height << " " << fourccName(wanted.fourcc)
+         << " asked, " << actual.width << " x " << actual.height << " given" << endl;
+    return true;
+}
+
+void CaptureNegotiator::setUncompressed(bool uncompressed) {
+    if(uncompressed != m_uncompressed) {
+        m_uncompressed = uncompressed;
+        m_mode.width = 0;
+        m_mode.height = 0;
+    }
+}
+
+Size CaptureNegotiator::actualSize() const {
+    return Size(static_cast<int>(m_camera.get(CAP_PROP_FRAME_WIDTH)), static_cast<int>(m_camera.get(CAP_PROP_FRAME_HEIGHT)));
+}
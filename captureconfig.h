@@ -0,0 +1,52 @@
+#ifndef CAPTURECONFIG_H_INCLUDED
+#define CAPTURECONFIG_H_INCLUDED
+
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+//Chooses the camera resolution from what the electrodes need,
+//instead of pulling 1080p from the camera to make a 10 x 6 grid.
+
+//Size a frame must have so that, once reduceImage() kept 'angle' % of its width,
+//every electrode still averages at least pixelsPerElectrode x pixelsPerElectrode pixels
+cv::Size requiredResolution(int angle, int electrodes_w, int electrodes_h, int pixelsPerElectrode);
+
+struct CaptureMode {
+    int width;
+    int height;
+    int fourcc; //Uncompressed YUYV for the small modes, MJPEG when YUYV would not fit in USB 2 bandwidth
+};
+
+//Smallest usual webcam mode at least as big as 'required' (the biggest one if none is).
+//'uncompressed' forces YUYV whatever the size, for the raw luma mode.
+CaptureMode chooseCaptureMode(cv::Size const& required, bool uncompressed = false);
+
+class CaptureNegotiator {
+public:
+    explicit CaptureNegotiator(cv::VideoCapture& camera, int pixelsPerElectrode = 4);
+
+    //Renegotiate when the current mode is too small for the electrodes, or at least twice too big.
+    //A camera takes a while to restart, so this happens at most once per 'minimumDelayMs'.
+    //Returns true if the mode changed.
+    bool update(int angle, int electrodes_w, int electrodes_h, int minimumDelayMs = 1000);
+
+    //Mode currently asked to the camera (0 x 0 before the first update())
+    CaptureMode const& mode() const { return m_mode; }
+    cv::Size actualSize() const;
+
+    void setPixelsPerElectrode(int pixelsPerElectrode) { m_pixelsPerElectrode = pixelsPerElectrode; }
+
+    //Only YUYV modes, the next update() renegotiates
+    void setUncompressed(bool uncompressed);
+
+private:
+    cv::VideoCapture& m_camera;
+    int m_pixelsPerElectrode;
+    bool m_uncompressed;
+    CaptureMode m_mode;
+    uint64_t m_lastChangeNs;
+};
+
+#endif // CAPTURECONFIG_H_INCLUDED
@@ -0,0 +1,85 @@
+#include "contrast.h"
+
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+AdaptiveContrast::AdaptiveContrast(int clip, int speed, int minimumRange)
+    : m_clip(0), m_speed(min(max(speed, 1), 256)), m_minimumRange(min(max(minimumRange, 1), 255)), m_low(-1), m_high(-1) {
+    setClip(clip);
+    m_table.create(1, 256, CV_8UC1);
+}
+
+void AdaptiveContrast::setClip(int clip) {
+    m_clip = min(max(clip, 0), 49);
+}
+
+void AdaptiveContrast::reset() {
+    m_low = -1;
+    m_high = -1;
+}
+
+void AdaptiveContrast::apply(Mat& electrodes, Mat const& live) {
+    if(electrodes.type() != CV_8UC1 || electrodes.empty()) {
+        return;
+    }
+    bool const masked(!live.empty());
+    if(masked && (live.type() != CV_8UC1 || live.size() != electrodes.size())) {
+        return;
+    }
+
+    //Histogram of the electrodes, a few thousands values at most
+    int histogram[256] = {};
+    int total(0);
+    for(int y(0); y < electrodes.rows; ++y) {
+        uchar const* p(electrodes.ptr<uchar>(y));
+        uchar const* m(masked ? live.ptr<uchar>(y) : nullptr);
+        for(int x(0); x < electrodes.cols; ++x) {
+            if(!masked || m[x] != 0) {
+                ++histogram[p[x]];
+                ++total;
+            }
+        }
+    }
+
+    //Nothing stimulates : the bounds stay where they were
+    if(total == 0) {
+        return;
+    }
+
+    int const skipped(total * m_clip / 100);
+    int low(0), high(255), count(0);
+    for(count = 0; low < 255 && count + histogram[low] <= skipped; ++low) {
+        count += histogram[low];
+    }
+    for(count = 0; high > 0 && count + histogram[high] <= skipped; --high) {
+        count += histogram[high];
+    }
+
+    //A flat scene keeps a minimal range around its middle
+    if(high - low < m_minimumRange) {
+        int const middle((low + high) / 2);
+        low = max(middle - m_minimumRange / 2, 0);
+        high = min(low + m_minimumRange, 255);
+        low = high - m_minimumRange;
+    }
+
+    if(m_low < 0) {
+        m_low = low << 8;
+        m_high = high << 8;
+    } else {
+        m_low += ((low << 8) - m_low) * m_speed >> 8;
+        m_high += ((high << 8) - m_high) * m_speed >> 8;
+    }
+
+    //Stretch low..high to 0..255 through a table
+    int const from(this->low()), range(max(this->high() - from, 1));
+    uchar* table(m_table.ptr<uchar>(0));
+    for(int v(0); v < 256; ++v) {
+        table[v] = saturate_cast<uchar>(((v - from) * 255 + range / 2) / range);
+    }
+    LUT(electrodes, m_table, electrodes);
+}
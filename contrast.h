@@ -0,0 +1,33 @@
+#ifndef CONTRAST_H_INCLUDED
+#define CONTRAST_H_INCLUDED
+
+#include <opencv2/core.hpp>
+
+//Automatic contrast : the electrodes are stretched so a dim scene still uses all the levels.
+//The darkest and brightest electrodes (after 'clip' % of outliers on each side) go to 0 and 255,
+//the statistics coming from the electrode frame, not from the camera frame.
+//The bounds move slowly from frame to frame, so the brightness does not pump.
+class AdaptiveContrast {
+public:
+    //'clip' : percentage of electrodes ignored at each end of the histogram.
+    //'speed' : part of the way to the new bounds done every frame, out of 256.
+    //'minimumRange' : the stretch never goes beyond 255 / minimumRange, not to amplify the noise of a flat scene.
+    explicit AdaptiveContrast(int clip = 2, int speed = 32, int minimumRange = 32);
+
+    void setClip(int clip);
+    void reset();
+
+    //'live' : CV_8UC1 of the size of the electrodes, only the non zero ones count in the statistics
+    //(the dead and stuck electrodes of a DefectMap would hold the bounds). Empty : all of them.
+    void apply(cv::Mat& electrodes, cv::Mat const& live = cv::Mat());
+
+    int low() const { return (m_low + 128) >> 8; }
+    int high() const { return (m_high + 128) >> 8; }
+
+private:
+    int m_clip, m_speed, m_minimumRange;
+    int m_low, m_high; //Bounds with 8 fractional bits, -1 until the first frame
+    cv::Mat m_table;   //CV_8UC1, 256 entries
+};
+
+#endif // CONTRAST_H_INCLUDED
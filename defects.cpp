@@ -0,0 +1,175 @@
+#include "defects.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "fixedpoint.h"
+
+using namespace cv;
+using namespace std;
+
+DefectMap::DefectMap() {
+}
+
+bool DefectMap::load(string const& filename) {
+    ifstream file(filename.c_str());
+    if(!file) {
+        return false;
+    }
+
+    clear();
+    string line;
+    int number(0);
+    while(getline(file, line)) {
+        ++number;
+        if(line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        Defect defect;
+        char state[16] = "";
+        float value(-1);
+        int read(sscanf(line.c_str(), "%d %d %15s %f", &defect.x, &defect.y, state, &value));
+        if(read < 3 || defect.x < 0 || defect.y < 0) {
+            cout << filename << ":" << number << " : expected \"x y dead|stuck|weak [value]\"" << endl;
+            continue;
+        }
+
+        string const name(state);
+        if(name == "dead") {
+            defect.state = DEAD;
+            defect.value = 0;
+        } else if(name == "stuck") {
+            defect.state = STUCK;
+            defect.value = read == 4 ? min(max(cvRound(value), 0), 255) : 255;
+        } else if(name == "weak" && read == 4) {
+            defect.state = WEAK;
+            defect.value = min(max(cvRound(value * 256), 0), 256);
+        } else {
+            cout << filename << ":" << number << " : unknown state \"" << name << "\"" << endl;
+            continue;
+        }
+        m_defects.push_back(defect);
+    }
+
+    cout << m_defects.size() << " defective electrodes in " << filename << endl;
+    return true;
+}
+
+void DefectMap::clear() {
+    m_defects.clear();
+    m_grid = Size();
+}
+
+void DefectMap::compile(int electrodes_w, int electrodes_h) {
+    if(m_grid == Size(electrodes_w, electrodes_h)) {
+        return;
+    }
+    m_grid = Size(electrodes_w, electrodes_h);
+
+    size_t const electrodes(static_cast<size_t>(electrodes_w) * electrodes_h);
+    m_gain.assign(electrodes, 256);
+    m_offset.assign(electrodes, 0);
+
+    //Electrodes out of the grid are ignored, the map may be for a bigger implant
+    for(Defect const& defect : m_defects) {
+        if(defect.x >= electrodes_w || defect.y >= electrodes_h) {
+            continue;
+        }
+        size_t const i(static_cast<size_t>(defect.y) * electrodes_w + defect.x);
+        m_gain[i] = defect.state == WEAK ? defect.value : 0;
+        m_offset[i] = defect.state == STUCK ? defect.value << 8 : 0;
+    }
+
+    //Only the electrodes with a gain are worth summing
+    m_live.clear();
+    m_rowStart.assign(electrodes_h + 1, 0);
+    for(int y(0); y < electrodes_h; ++y) {
+        m_rowStart[y] = m_live.size();
+        for(int x(0); x < electrodes_w; ++x) {
+            if(m_gain[y * electrodes_w + x] != 0) {
+                m_live.push_back(x);
+            }
+        }
+    }
+    m_rowStart[electrodes_h] = m_live.size();
+}
+
+void DefectMap::apply(Mat& electrodes) {
+    if(empty() || electrodes.depth() != CV_8U || electrodes.empty()) {
+        return;
+    }
+
+    //A defective electrode is so for all its channels
+    int const channels(electrodes.channels());
+    compile(electrodes.cols, electrodes.rows);
+    for(int y(0); y < electrodes.rows; ++y) {
+        uchar* p(electrodes.ptr<uchar>(y));
+        uint16_t const* gain(&m_gain[y * electrodes.cols]);
+        uint16_t const* offset(&m_offset[y * electrodes.cols]);
+        for(int x(0); x < electrodes.cols; ++x) {
+            for(int c(0); c < channels; ++c, ++p) {
+                *p = (*p * gain[x] + offset[x] + 128) >> 8;
+            }
+        }
+    }
+}
+
+void DefectMap::liveMask(int electrodes_w, int electrodes_h, Mat& mask) {
+    mask.create(electrodes_h, electrodes_w, CV_8UC1);
+    if(empty()) {
+        mask.setTo(Scalar(255));
+        return;
+    }
+
+    compile(electrodes_w, electrodes_h);
+    for(int y(0); y < electrodes_h; ++y) {
+        uchar* p(mask.ptr<uchar>(y));
+        uint16_t const* gain(&m_gain[y * electrodes_w]);
+        for(int x(0); x < electrodes_w; ++x) {
+            p[x] = gain[x] != 0 ? 255 : 0;
+        }
+    }
+}
+
+void DefectMap::pixelise(Mat const& img, int electrodes_w, int electrodes_h, Mat& electrodes) {
+    if(img.type() != CV_8UC1 || img.empty()) {
+        return;
+    }
+
+    //Same rules as pixeliseImage()
+    electrodes_w = min(max(electrodes_w, 1), img.cols);
+    electrodes_h = min(max(electrodes_h, 1), img.rows);
+    compile(electrodes_w, electrodes_h);
+
+    electrodes.create(electrodes_h, electrodes_w, CV_8UC1);
+    int const blockW(img.cols / electrodes_w),
+              blockH(img.rows / electrodes_h);
+    BlockDivisor const divisor(blockW * blockH);
+    vector<uint32_t> sums(electrodes_w);
+
+    for(int by(0); by < electrodes_h; ++by) {
+        fill(sums.begin(), sums.end(), 0);
+        int const* live(m_live.data() + m_rowStart[by]);
+        int const count(static_cast<int>(m_rowStart[by + 1] - m_rowStart[by]));
+
+        for(int y(by * blockH); y < (by + 1) * blockH; ++y) {
+            uchar const* row(img.ptr<uchar>(y));
+            for(int i(0); i < count; ++i) {
+                uchar const* p(row + live[i] * blockW);
+                uint32_t sum(0);
+                for(int x(0); x < blockW; ++x) {
+                    sum += p[x];
+                }
+                sums[live[i]] += sum;
+            }
+        }
+
+        uchar* out(electrodes.ptr<uchar>(by));
+        for(int bx(0); bx < electrodes_w; ++bx) {
+            out[bx] = divisor.divide(sums[bx]);
+        }
+    }
+}
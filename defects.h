@@ -0,0 +1,61 @@
+#ifndef DEFECTS_H_INCLUDED
+#define DEFECTS_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//Electrodes of a patient which do not work as they should, read from a text file :
+//  # x y state [value]
+//  3 2 dead          never stimulates
+//  5 0 stuck 200     always at this gray (255 if not given)
+//  7 4 weak 0.5      gain between 0 and 1
+//x is the column and y the row of the electrode frame (spoke and ring in the foveated layout).
+//
+//For a given grid the map is turned into a gain and an offset per electrode, so applying it is the same
+//multiply-add everywhere, whatever the state of the electrode.
+class DefectMap {
+public:
+    DefectMap();
+
+    bool load(std::string const& filename);
+    void clear();
+    bool empty() const { return m_defects.empty(); }
+    size_t size() const { return m_defects.size(); }
+
+    //electrode = (electrode * gain + offset) / 256, right after the electrodes are computed (every channel of the BGR ones)
+    void apply(cv::Mat& electrodes);
+
+    //255 for the electrodes which stimulate (working or weak), 0 for the dead and stuck ones
+    void liveMask(int electrodes_w, int electrodes_h, cv::Mat& mask);
+
+    //pixeliseImageFixed(), without summing the electrodes apply() overwrites (dead and stuck ones)
+    void pixelise(cv::Mat const& img, int electrodes_w, int electrodes_h, cv::Mat& electrodes);
+
+private:
+    enum State {
+        DEAD,
+        STUCK,
+        WEAK
+    };
+
+    struct Defect {
+        int x, y;
+        State state;
+        int value; //Gray of a stuck electrode, gain of a weak one (8 fractional bits)
+    };
+
+    //Tables for a grid, only rebuilt when its size changes
+    void compile(int electrodes_w, int electrodes_h);
+
+    std::vector<Defect> m_defects;
+    cv::Size m_grid;
+    std::vector<uint16_t> m_gain;   //8 fractional bits, 0 to 256
+    std::vector<uint16_t> m_offset; //8 fractional bits
+    std::vector<int> m_live;        //Columns to sum of every row of the grid, row after row
+    std::vector<size_t> m_rowStart; //Columns of row y : [m_rowStart[y], m_rowStart[y + 1])
+};
+
+#endif // DEFECTS_H_INCLUDED
@@ -0,0 +1,168 @@
+#include "display.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <opencv2/highgui.hpp>
+
+using namespace cv;
+using namespace std;
+
+DisplayThread::DisplayThread(int rate) : m_rate(max(rate, 1)), m_running(false) {
+}
+
+DisplayThread::~DisplayThread() {
+    stop();
+}
+
+int DisplayThread::addWindow(string const& name, bool visible) {
+    m_windows.emplace_back();
+    Window& window(m_windows.back());
+    window.name = name;
+    window.visible = visible;
+    window.wanted = true;
+    window.shown = false;
+    window.fresh = false;
+    return m_windows.size() - 1;
+}
+
+int DisplayThread::addTrackbar(string const& name, int window, int value, int count) {
+    m_trackbars.emplace_back();
+    Trackbar& trackbar(m_trackbars.back());
+    trackbar.name = name;
+    trackbar.window = window;
+    trackbar.count = count;
+    //As HighGUI does with the position, nothing else may ever come out of value()
+    trackbar.position = min(max(value, 0), count);
+    trackbar.value = trackbar.position;
+    return m_trackbars.size() - 1;
+}
+
+void DisplayThread::start() {
+    if(m_running) {
+        return;
+    }
+
+    m_running = true;
+    m_thread = thread(&DisplayThread::run, this);
+}
+
+void DisplayThread::stop() {
+    if(!m_running) {
+        return;
+    }
+
+    m_running = false;
+    m_thread.join();
+}
+
+void DisplayThread::setRate(int rate) {
+    m_rate = max(rate, 1);
+}
+
+void DisplayThread::setVisible(int window, bool visible) {
+    for(Trackbar const& trackbar : m_trackbars) {
+        if(trackbar.window == window) {
+            return;
+        }
+    }
+
+    m_windows[window].visible = visible;
+}
+
+bool DisplayThread::isVisible(int window) const {
+    return m_windows[window].visible;
+}
+
+void DisplayThread::show(int window, Mat const& img) {
+    if(!wants(window)) {
+        return;
+    }
+
+    Window& target(m_windows[window]);
+    lock_guard<mutex> lock(m_mutex);
+    img.copyTo(target.pending);
+    target.fresh = true;
+    target.wanted = false;
+}
+
+bool DisplayThread::wants(int window) const {
+    return m_windows[window].visible && m_windows[window].wanted;
+}
+
+int DisplayThread::value(int trackbar) const {
+    return m_trackbars[trackbar].value;
+}
+
+int DisplayThread::takeKey() {
+    lock_guard<mutex> lock(m_mutex);
+    if(m_keys.empty()) {
+        return -1;
+    }
+
+    int key(m_keys.front());
+    m_keys.pop_front();
+    return key;
+}
+
+void DisplayThread::onTrackbar(int position, void* trackbar) {
+    static_cast<Trackbar*>(trackbar)->value = position;
+}
+
+void DisplayThread::run() {
+    //Windows and trackbars belong to this thread
+    for(Window& window : m_windows) {
+        if(window.visible) {
+            namedWindow(window.name, WINDOW_AUTOSIZE);
+            window.shown = true;
+        }
+    }
+    for(Trackbar& trackbar : m_trackbars) {
+        createTrackbar(trackbar.name, m_windows[trackbar.window].name, &trackbar.position, trackbar.count, &DisplayThread::onTrackbar, &trackbar);
+    }
+
+    chrono::steady_clock::time_point next(chrono::steady_clock::now());
+
+    while(m_running) {
+        next += chrono::microseconds(1000000 / m_rate);
+
+        for(Window& window : m_windows) {
+            if(window.visible != window.shown) {
+                if(window.visible) {
+                    namedWindow(window.name, WINDOW_AUTOSIZE);
+                } else {
+                    destroyWindow(window.name);
+                }
+                window.shown = window.visible;
+            }
+
+            bool fresh(false);
+            {
+                lock_guard<mutex> lock(m_mutex);
+                if(window.fresh) {
+                    swap(window.showing, window.pending);
+                    window.fresh = false;
+                    fresh = true;
+                }
+            }
+            if(fresh && window.shown) {
+                imshow(window.name, window.showing);
+            }
+            window.wanted = true;
+        }
+
+        //waitKey() both repaints and waits for the next refresh
+        int wait(static_cast<int>(chrono::duration_cast<chrono::milliseconds>(next - chrono::steady_clock::now()).count()));
+        if(wait < 1) {
+            wait = 1;
+            next = chrono::steady_clock::now();
+        }
+        int key(waitKey(wait));
+        if(key != -1) {
+            lock_guard<mutex> lock(m_mutex);
+            m_keys.push_back(key);
+        }
+    }
+
+    destroyAllWindows();
+}
@@ -0,0 +1,81 @@
+#ifndef DISPLAY_H_INCLUDED
+#define DISPLAY_H_INCLUDED
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <opencv2/core.hpp>
+
+//Shows the pictures from its own thread, at most 'rate' times per second, so imshow() and waitKey()
+//no longer slow down the processing. HighGUI wants the windows, the trackbars and waitKey() in the
+//same thread : everything GUI is done here, the processing only posts pictures and reads values.
+class DisplayThread {
+public:
+    explicit DisplayThread(int rate = 30);
+    ~DisplayThread();
+
+    //Before start(). Returns the id to give to show() / value().
+    int addWindow(std::string const& name, bool visible = true);
+    int addTrackbar(std::string const& name, int window, int value, int count);
+
+    void start();
+    void stop();
+
+    //Refreshes per second
+    void setRate(int rate);
+
+    //Optional windows can be hidden, show() does nothing for them then.
+    //The windows holding trackbars always stay.
+    void setVisible(int window, bool visible);
+    bool isVisible(int window) const;
+
+    //Give the latest picture of a window. It is only copied when the display is about to refresh,
+    //the other calls cost nothing.
+    void show(int window, cv::Mat const& img);
+
+    //True if show() would take a picture now, to skip preparing pictures nobody will see
+    bool wants(int window) const;
+
+    int value(int trackbar) const;
+
+    //Next key pressed in a window, -1 if none
+    int takeKey();
+
+private:
+    DisplayThread(DisplayThread const&);
+    DisplayThread& operator=(DisplayThread const&);
+
+    struct Window {
+        std::string name;
+        std::atomic<bool> visible;
+        std::atomic<bool> wanted; //The display thread waits for a new picture
+        bool shown;               //Only used by the display thread
+        cv::Mat showing;          //Same
+        cv::Mat pending;          //Protected by m_mutex
+        bool fresh;
+    };
+
+    struct Trackbar {
+        std::string name;
+        int window;
+        int count;
+        int position; //Written by HighGUI, in the display thread
+        std::atomic<int> value;
+    };
+
+    static void onTrackbar(int position, void* trackbar);
+    void run();
+
+    std::deque<Window> m_windows;
+    std::deque<Trackbar> m_trackbars;
+    std::atomic<int> m_rate;
+    std::atomic<bool> m_running;
+    std::mutex m_mutex;
+    std::deque<int> m_keys; //Protected by m_mutex
+    std::thread m_thread;
+};
+
+#endif // DISPLAY_H_INCLUDED
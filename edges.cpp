@@ -0,0 +1,99 @@
+#include "edges.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "fixedpoint.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+//Edge strength of row 'center', 'above' and 'below' being its neighbours (itself at the borders)
+void edgeRow(uchar const* above, uchar const* center, uchar const* below, int cols, EdgeMode mode, int gain, uchar* out) {
+    int const last(cols - 1);
+    if(mode == EDGE_SOBEL) {
+        for(int x(0); x < cols; ++x) {
+            int const left(x > 0 ? x - 1 : 0),
+                      right(x < last ? x + 1 : last);
+            int const gx((above[right] + 2 * center[right] + below[right]) - (above[left] + 2 * center[left] + below[left])),
+                      gy((below[left] + 2 * below[x] + below[right]) - (above[left] + 2 * above[x] + above[right]));
+            out[x] = min((abs(gx) + abs(gy)) * gain >> 3, 255);
+        }
+    } else {
+        for(int x(0); x < cols; ++x) {
+            int const left(x > 0 ? x - 1 : 0),
+                      right(x < last ? x + 1 : last);
+            out[x] = min(abs(4 * center[x] - above[x] - below[x] - center[left] - center[right]) * gain >> 2, 255);
+        }
+    }
+}
+
+}
+
+void pixeliseEdges(Mat const& crop, int electrodes_w, int electrodes_h, EdgeMode mode, int gain, Mat& electrodes) {
+    if((crop.type() != CV_8UC1 && crop.type() != CV_8UC3) || crop.empty() || mode == EDGE_NONE) {
+        return;
+    }
+
+    //Same rules as pixeliseImage()
+    electrodes_w = min(max(electrodes_w, 1), crop.cols);
+    electrodes_h = min(max(electrodes_h, 1), crop.rows);
+    int const blockW(crop.cols / electrodes_w),
+              blockH(crop.rows / electrodes_h);
+    BlockDivisor const divisor(blockW * blockH);
+    gain = max(gain, 1);
+
+    //Last 3 gray rows, row y being in window.row(y % 3), and the edges of the current row
+    bool const bgr(crop.type() == CV_8UC3);
+    Mat window(bgr ? 3 : 0, crop.cols, CV_8UC1);
+    vector<uchar> edges(crop.cols);
+    auto grayRow = [&](int y) -> uchar const* {
+        if(!bgr) {
+            return crop.ptr<uchar>(y);
+        }
+        return window.ptr<uchar>(y % 3);
+    };
+    auto convertRow = [&](int y) {
+        if(bgr) {
+            Mat line(window.row(y % 3));
+            convertImageToGrayScaleFixed(crop.row(y), line);
+        }
+    };
+
+    electrodes.create(electrodes_h, electrodes_w, CV_8UC1);
+    vector<uint32_t> sums(electrodes_w);
+    convertRow(0);
+
+    for(int by(0); by < electrodes_h; ++by) {
+        fill(sums.begin(), sums.end(), 0);
+
+        for(int y(by * blockH); y < (by + 1) * blockH; ++y) {
+            //The row below is needed now, the one above is still in the window
+            if(y + 1 < crop.rows) {
+                convertRow(y + 1);
+            }
+            uchar const* above(grayRow(y > 0 ? y - 1 : 0));
+            uchar const* center(grayRow(y));
+            uchar const* below(grayRow(y + 1 < crop.rows ? y + 1 : y));
+            edgeRow(above, center, below, crop.cols, mode, gain, edges.data());
+
+            uchar const* p(edges.data());
+            for(int bx(0); bx < electrodes_w; ++bx, p += blockW) {
+                uint32_t sum(0);
+                for(int x(0); x < blockW; ++x) {
+                    sum += p[x];
+                }
+                sums[bx] += sum;
+            }
+        }
+
+        uchar* out(electrodes.ptr<uchar>(by));
+        for(int bx(0); bx < electrodes_w; ++bx) {
+            out[bx] = divisor.divide(sums[bx]);
+        }
+    }
+}
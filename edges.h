@@ -0,0 +1,21 @@
+#ifndef EDGES_H_INCLUDED
+#define EDGES_H_INCLUDED
+
+#include <opencv2/core.hpp>
+
+//With few electrodes, the outlines of the objects say more than their mean gray.
+//The electrodes can average the edge strength of their block instead of its gray.
+
+enum EdgeMode {
+    EDGE_NONE,
+    EDGE_SOBEL,    //|gx| + |gy| of the 3x3 Sobel, / 8
+    EDGE_LAPLACIAN //|4 c - n - s - w - e|, / 4
+};
+
+//pixeliseImageFixed() of the edge strength of 'crop', times 'gain' and clamped to 255.
+//'crop' is gray or BGR (converted row by row as in convertImageToGrayScaleFixed()).
+//The edges are computed row after row from the last 3 gray rows and summed straight into the electrodes :
+//neither the gray picture nor the edge picture are ever stored whole. The borders of the crop are replicated.
+void pixeliseEdges(cv::Mat const& crop, int electrodes_w, int electrodes_h, EdgeMode mode, int gain, cv::Mat& electrodes);
+
+#endif // EDGES_H_INCLUDED
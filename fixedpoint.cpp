@@ -0,0 +1,262 @@
+#include "fixedpoint.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "processing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+//tab[c * 256 + v] = weight of the channel c * v, rounding included in the red part.
+//A lookup is cheaper than a multiplication on our targets.
+struct LumaTable {
+    int shift;
+    int tab[3 * 256];
+
+    LumaTable(int b, int g, int r, int s) : shift(s) {
+        for(int v(0); v < 256; ++v) {
+            tab[v] = b * v;
+            tab[256 + v] = g * v;
+            tab[512 + v] = r * v + (1 << (s - 1));
+        }
+    }
+};
+
+LumaTable const& lumaTable(LumaPrecision precision) {
+    static LumaTable const q8(29, 150, 77, 8);
+    static LumaTable const q14(1868, 9617, 4899, 14);
+    return precision == LUMA_Q8 ? q8 : q14;
+}
+
+}
+
+BlockDivisor::BlockDivisor(uint32_t divisor) {
+    if(divisor == 0) {
+        divisor = 1;
+    }
+
+    //Rounded up : the error stays under 1 / divisor as long as x <= 255 * divisor
+    m_multiplier = ((1ull << SHIFT) + divisor - 1) / divisor;
+}
+
+void convertImageToGrayScaleFixed(Mat const& bgr, Mat& gray, LumaPrecision precision) {
+    if(bgr.type() == CV_8UC1) {
+        bgr.copyTo(gray);
+        return;
+    }
+    if(bgr.type() != CV_8UC3) {
+        cout << "Unexpected picture type. 3 channels of 8 bits expected." << endl;
+        return;
+    }
+
+    gray.create(bgr.rows, bgr.cols, CV_8UC1);
+    for(int y(0); y < bgr.rows; ++y) {
+        convertRowToGrayScaleFixed(bgr.ptr<uchar>(y), 3, bgr.cols, gray.ptr<uchar>(y), precision);
+    }
+}
+
+void convertRowToGrayScaleFixed(uchar const* bgr, int step, int count, uchar* gray, LumaPrecision precision) {
+    LumaTable const& table(lumaTable(precision));
+    for(int x(0); x < count; ++x, bgr += step) {
+        gray[x] = (table.tab[bgr[0]] + table.tab[256 + bgr[1]] + table.tab[512 + bgr[2]]) >> table.shift;
+    }
+}
+
+Rect reduceRectFixed(int cols, int rows, int angle, int electrodes_w, int electrodes_h) {
+    //Same rules as reduceImage()
+    if(electrodes_w <= 0) {
+        return Rect(0, 0, cols, rows);
+    }
+
+    int w(cols * angle / 100),
+        h(w * electrodes_h / electrodes_w),
+        x((cols - w) / 2),
+        y((rows - h) / 2);
+
+    if(w == 0 || h == 0) {
+        return Rect(0, 0, cols, rows);
+    }
+
+    if(w + x > cols) {
+        return Rect(0, y, cols, h);
+    } else if(h + y > rows) {
+        return Rect(x, 0, w, rows);
+    }
+    return Rect(x, y, w, h);
+}
+
+void reduceImageFixed(Mat& img, int angle, int electrodes_w, int electrodes_h) {
+    img = Mat(img, reduceRectFixed(img.cols, img.rows, angle, electrodes_w, electrodes_h));
+}
+
+void pixeliseImageFixed(Mat const& img, int electrodes_w, int electrodes_h, Mat& electrodes) {
+    int const channels(img.channels());
+    if(channels != 1 && channels != 3) {
+        cout << "Too more channels. Channel expected 1 or 3." << endl;
+        return;
+    }
+    if(img.empty()) {
+        return;
+    }
+
+    electrodes_w = min(max(electrodes_w, 1), img.cols);
+    electrodes_h = min(max(electrodes_h, 1), img.rows);
+
+    electrodes.create(electrodes_h, electrodes_w, CV_8UC(channels));
+    int blockW(img.cols / electrodes_w),
+        blockH(img.rows / electrodes_h);
+    BlockDivisor divisor(blockW * blockH);
+
+    //Row after row, so the picture is read once in memory order.
+    //BGR stays interleaved : one pass, three sums per electrode.
+    vector<uint32_t> sums(electrodes_w * channels);
+    for(int by(0); by < electrodes_h; ++by) {
+        fill(sums.begin(), sums.end(), 0);
+
+        for(int y(by * blockH); y < (by + 1) * blockH; ++y) {
+            uchar const* p(img.ptr<uchar>(y));
+            if(channels == 1) {
+                for(int bx(0); bx < electrodes_w; ++bx, p += blockW) {
+                    uint32_t sum(0);
+                    for(int x(0); x < blockW; ++x) {
+                        sum += p[x];
+                    }
+                    sums[bx] += sum;
+                }
+            } else {
+                for(int bx(0); bx < electrodes_w; ++bx, p += blockW * 3) {
+                    uint32_t b(0), g(0), r(0);
+                    for(int x(0); x < blockW * 3; x += 3) {
+                        b += p[x];
+                        g += p[x + 1];
+                        r += p[x + 2];
+                    }
+                    sums[bx * 3] += b;
+                    sums[bx * 3 + 1] += g;
+                    sums[bx * 3 + 2] += r;
+                }
+            }
+        }
+
+        uchar* out(electrodes.ptr<uchar>(by));
+        for(int i(0); i < electrodes_w * channels; ++i) {
+            out[i] = divisor.divide(sums[i]);
+        }
+    }
+}
+
+void pixeliseImageFixed(Mat& img, int electrodes_w, int electrodes_h) {
+    Mat electrodes;
+    pixeliseImageFixed(img, electrodes_w, electrodes_h, electrodes);
+    if(!electrodes.empty()) {
+        img = electrodes;
+    }
+}
+
+TemporalFilterFixed::TemporalFilterFixed(int alpha) {
+    setAlpha(alpha);
+}
+
+void TemporalFilterFixed::setAlpha(int alpha) {
+    m_alpha = min(max(alpha, 0), 256);
+}
+
+void TemporalFilterFixed::reset() {
+    m_state.release();
+}
+
+void TemporalFilterFixed::apply(Mat& electrodes) {
+    if(electrodes.depth() != CV_8U) {
+        return;
+    }
+
+    //Every channel of an electrode smoothed on its own
+    int const values(electrodes.cols * electrodes.channels());
+
+    //New geometry : nothing to smooth with
+    if(m_state.rows != electrodes.rows || m_state.cols != values) {
+        m_state.create(electrodes.rows, values, CV_32SC1);
+        for(int y(0); y < electrodes.rows; ++y) {
+            uchar const* p(electrodes.ptr<uchar>(y));
+            int* state(m_state.ptr<int>(y));
+            for(int x(0); x < values; ++x) {
+                state[x] = p[x] << 8;
+            }
+        }
+        return;
+    }
+
+    for(int y(0); y < electrodes.rows; ++y) {
+        uchar* p(electrodes.ptr<uchar>(y));
+        int* state(m_state.ptr<int>(y));
+        for(int x(0); x < values; ++x) {
+            state[x] += (((p[x] << 8) - state[x]) * m_alpha) >> 8;
+            p[x] = (state[x] + 128) >> 8;
+        }
+    }
+}
+
+void runFixedPointPipeline(Mat& img, int angle, int electrodes_w, int electrodes_h, LumaPrecision precision) {
+    //Crop before the conversion, the rest of the frame is never converted
+    Mat crop(img, reduceRectFixed(img.cols, img.rows, angle, electrodes_w, electrodes_h));
+    Mat gray;
+    convertImageToGrayScaleFixed(crop, gray, precision);
+    pixeliseImageFixed(gray, electrodes_w, electrodes_h);
+    img = gray;
+}
+
+bool checkFixedPointPipeline(int iterations) {
+    RNG rng(0x42455945);
+    int geometryErrors(0), electrodeErrors(0), lumaMaxDiff(0);
+
+    for(int i(0); i < iterations; ++i) {
+        int cols(rng.uniform(1, 700)), rows(rng.uniform(1, 500)),
+            angle(rng.uniform(0, 101)),
+            electrodes_w(rng.uniform(0, 120)), electrodes_h(rng.uniform(0, 80));
+        Mat bgr(rows, cols, CV_8UC3);
+        randu(bgr, Scalar::all(0), Scalar::all(256));
+
+        //Luma : OpenCV may use IPP, whose float weights round differently on a few pixels
+        Mat gray, grayFixed;
+        cvtColor(bgr, gray, COLOR_BGR2GRAY);
+        convertImageToGrayScaleFixed(bgr, grayFixed);
+        Mat diff;
+        absdiff(gray, grayFixed, diff);
+        double maxDiff(0);
+        minMaxLoc(diff, nullptr, &maxDiff);
+        lumaMaxDiff = max(lumaMaxDiff, static_cast<int>(maxDiff));
+
+        //Geometry, a grid 0 wide included
+        Mat reduced(gray);
+        reduceImage(reduced, angle, (double)electrodes_h / (double)electrodes_w);
+        Rect expected(reduceRectFixed(cols, rows, angle, electrodes_w, electrodes_h));
+        if(reduced.size() != expected.size()) {
+            ++geometryErrors;
+            cout << "  geometry " << cols << "x" << rows << " angle " << angle << " grid " << electrodes_w << "x" << electrodes_h
+                 << " : " << reduced.cols << "x" << reduced.rows << " instead of " << expected.width << "x" << expected.height << endl;
+        }
+
+        //Electrodes, on the same crop
+        Mat reference(reduced.clone()), fixed(reduced.clone());
+        pixeliseImage(reference, electrodes_w, electrodes_h);
+        pixeliseImageFixed(fixed, electrodes_w, electrodes_h);
+        if(reference.size() != fixed.size() || countNonZero(reference != fixed) != 0) {
+            ++electrodeErrors;
+            cout << "  electrodes " << reduced.cols << "x" << reduced.rows << " grid " << electrodes_w << "x" << electrodes_h << " differ" << endl;
+        }
+    }
+
+    cout << "Integer pipeline, " << iterations << " random pictures :\n";
+    cout << "  luma : max difference " << lumaMaxDiff << " (0 or 1 expected)\n";
+    cout << "  geometry : " << geometryErrors << " errors\n";
+    cout << "  electrodes : " << electrodeErrors << " errors" << endl;
+
+    return geometryErrors == 0 && electrodeErrors == 0 && lumaMaxDiff <= 1;
+}
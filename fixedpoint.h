@@ -0,0 +1,66 @@
+#ifndef FIXEDPOINT_H_INCLUDED
+#define FIXEDPOINT_H_INCLUDED
+
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+//Integer only version of the pipeline, for the processors without FPU we deploy on (-march=i486).
+//No float and no division per pixel or per electrode.
+
+enum LumaPrecision {
+    LUMA_Q8,  //77 R + 150 G + 29 B, 8 bits weights. Cheapest, can be 1 away from cvtColor
+    LUMA_Q14  //Same weights and rounding as cvtColor(COLOR_BGR2GRAY) in OpenCV own code path
+};
+
+//x / divisor, computed as (x * multiplier) >> 55.
+//Exact for every x <= 255 * divisor, that is any sum of 'divisor' 8 bits values, up to ~11 million values.
+class BlockDivisor {
+public:
+    explicit BlockDivisor(uint32_t divisor = 1);
+
+    uint32_t divide(uint64_t sum) const { return (sum * m_multiplier) >> SHIFT; }
+
+private:
+    static const int SHIFT = 55;
+    uint64_t m_multiplier;
+};
+
+//Same as convertImageToGrayScale(), 'gray' must not be 'bgr'
+void convertImageToGrayScaleFixed(cv::Mat const& bgr, cv::Mat& gray, LumaPrecision precision = LUMA_Q14);
+//One row of it, 'step' bytes from a pixel to the next (3 for BGR, 4 for BGRA)
+void convertRowToGrayScaleFixed(uchar const* bgr, int step, int count, uchar* gray, LumaPrecision precision = LUMA_Q14);
+
+//Part of a cols * rows picture kept by reduceImage(img, angle, electrodes_h / electrodes_w),
+//the ratio of the electrodes being kept as a fraction instead of a double
+cv::Rect reduceRectFixed(int cols, int rows, int angle, int electrodes_w, int electrodes_h);
+void reduceImageFixed(cv::Mat& img, int angle, int electrodes_w, int electrodes_h);
+
+//Same as pixeliseImage(), one BlockDivisor per call instead of one division per electrode
+void pixeliseImageFixed(cv::Mat& img, int electrodes_w, int electrodes_h);
+void pixeliseImageFixed(cv::Mat const& img, int electrodes_w, int electrodes_h, cv::Mat& electrodes);
+
+//Exponential smoothing of the electrodes from frame to frame :
+//  out = previous + (in - previous) * alpha / 256
+//alpha = 256 : no smoothing. State kept with 8 fractional bits, for every channel of the BGR electrodes too.
+class TemporalFilterFixed {
+public:
+    explicit TemporalFilterFixed(int alpha = 256);
+
+    void setAlpha(int alpha);
+    void reset();
+    void apply(cv::Mat& electrodes);
+
+private:
+    int m_alpha;
+    cv::Mat m_state; //CV_32SC1, Q8, one column per channel
+};
+
+//Grayscale, reduce and pixelise steps on 'bgr', integers only
+void runFixedPointPipeline(cv::Mat& img, int angle, int electrodes_w, int electrodes_h, LumaPrecision precision = LUMA_Q14);
+
+//Run both pipelines on random pictures and geometries and print the differences.
+//Returns false if the geometry or the electrodes do not match exactly.
+bool checkFixedPointPipeline(int iterations);
+
+#endif // FIXEDPOINT_H_INCLUDED
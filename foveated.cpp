@@ -0,0 +1,223 @@
+#include "foveated.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace cv;
+using namespace std;
+
+FoveatedSampler::FoveatedSampler(double fovea) : m_fovea(min(max(fovea, 0.001), 0.999)), m_rings(0), m_spokes(0), m_cache(nullptr) {
+}
+
+bool FoveatedSampler::configure(Size crop, int rings, int spokes) {
+    rings = max(rings, 1);
+    spokes = max(spokes, 1);
+    if(crop == m_size && rings == m_rings && spokes == m_spokes) {
+        return false;
+    }
+    m_size = crop;
+    m_rings = rings;
+    m_spokes = spokes;
+
+    uchar const* cached(nullptr);
+    size_t cachedSize(0);
+    if(m_cache && m_cache->find(cacheKey(), cached, cachedSize) && restoreTables(cached, cachedSize)) {
+        return true;
+    }
+
+    double const cx(crop.width / 2.0), cy(crop.height / 2.0),
+                 logFovea(log(m_fovea));
+
+    //Ring k goes from fovea^(1 - k / rings) to fovea^(1 - (k + 1) / rings) of the radius, the inner one
+    //also holds the centre. Done once per geometry, so double and log() are fine here.
+    m_runs.clear();
+    m_rowStart.assign(crop.height + 1, 0);
+    for(int y(0); y < crop.height; ++y) {
+        m_rowStart[y] = m_runs.size();
+        double const dy((y + 0.5 - cy) / cy);
+
+        for(int x(0); x < crop.width; ++x) {
+            double const dx((x + 0.5 - cx) / cx),
+                         r(sqrt(dx * dx + dy * dy));
+            if(r >= 1) {
+                continue;
+            }
+
+            int ring(r <= m_fovea ? 0 : static_cast<int>(rings * (1 - log(r) / logFovea)));
+            ring = min(max(ring, 0), rings - 1);
+            int spoke(static_cast<int>((atan2(dy, dx) + CV_PI) / (2 * CV_PI) * spokes));
+            spoke = min(max(spoke, 0), spokes - 1);
+            uint32_t const electrode(ring * spokes + spoke);
+
+            if(!m_runs.empty() && m_runs.size() > m_rowStart[y] && m_runs.back().electrode == electrode
+               && m_runs.back().x + m_runs.back().length == x) {
+                ++m_runs.back().length;
+            } else {
+                Run run = {static_cast<uint16_t>(x), 1, electrode};
+                m_runs.push_back(run);
+            }
+        }
+    }
+    m_rowStart[crop.height] = m_runs.size();
+    computeDivisors();
+
+    if(m_cache) {
+        vector<uchar> tables;
+        saveTables(tables);
+        m_cache->add(cacheKey(), tables);
+    }
+    return true;
+}
+
+LayoutCache::Key FoveatedSampler::cacheKey() const {
+    LayoutCache::Key key = {LayoutCache::FOVEATED_LAYOUT, m_size.width, m_size.height, m_rings, m_spokes, 0, m_fovea};
+    return key;
+}
+
+//Number of runs, the runs, then the start of every row and the end of the last one
+void FoveatedSampler::saveTables(vector<uchar>& tables) const {
+    uint64_t const runs(m_runs.size());
+    tables.resize(sizeof(runs) + runs * sizeof(Run) + m_rowStart.size() * sizeof(uint64_t));
+    uchar* p(tables.data());
+    memcpy(p, &runs, sizeof(runs));
+    p += sizeof(runs);
+    if(runs > 0) {
+        memcpy(p, m_runs.data(), runs * sizeof(Run));
+    }
+    p += runs * sizeof(Run);
+    for(size_t start : m_rowStart) {
+        uint64_t const value(start);
+        memcpy(p, &value, sizeof(value));
+        p += sizeof(value);
+    }
+}
+
+bool FoveatedSampler::restoreTables(uchar const* tables, size_t size) {
+    uint64_t runs(0);
+    size_t const rowStarts(m_size.height + 1);
+    if(size < sizeof(runs)) {
+        return false;
+    }
+    memcpy(&runs, tables, sizeof(runs));
+    if(runs > (size - sizeof(runs)) / sizeof(Run) || size != sizeof(runs) + runs * sizeof(Run) + rowStarts * sizeof(uint64_t)) {
+        return false;
+    }
+
+    m_runs.resize(runs);
+    if(runs > 0) {
+        memcpy(m_runs.data(), tables + sizeof(runs), runs * sizeof(Run));
+    }
+    m_rowStart.resize(rowStarts);
+    uchar const* p(tables + sizeof(runs) + runs * sizeof(Run));
+    for(size_t& start : m_rowStart) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        start = value;
+        p += sizeof(value);
+    }
+
+    //A table which would read out of the crop is planned again
+    uint32_t const electrodes(m_rings * m_spokes);
+    bool valid(m_rowStart[0] == 0 && m_rowStart[m_size.height] == runs);
+    for(int y(0); valid && y < m_size.height; ++y) {
+        valid = m_rowStart[y] <= m_rowStart[y + 1];
+        for(size_t i(m_rowStart[y]); valid && i < m_rowStart[y + 1]; ++i) {
+            valid = m_runs[i].electrode < electrodes && m_runs[i].x + m_runs[i].length <= m_size.width;
+        }
+    }
+    if(valid) {
+        computeDivisors();
+    }
+    return valid;
+}
+
+//The inner sectors can be smaller than a pixel : they read the pixel under their centre
+void FoveatedSampler::computeDivisors() {
+    int const electrodes(m_rings * m_spokes);
+    vector<uint32_t> counts(electrodes, 0);
+    for(Run const& run : m_runs) {
+        counts[run.electrode] += run.length;
+    }
+
+    double const cx(m_size.width / 2.0), cy(m_size.height / 2.0),
+                 logFovea(log(m_fovea));
+    m_divisors.resize(electrodes);
+    m_centres.clear();
+    for(int e(0); e < electrodes; ++e) {
+        m_divisors[e] = BlockDivisor(max(counts[e], 1u));
+        if(counts[e] == 0) {
+            int const ring(e / m_spokes), spoke(e % m_spokes);
+            double const r(ring == 0 ? m_fovea / 2 : exp(logFovea * (1 - (ring + 0.5) / m_rings))),
+                         a((spoke + 0.5) / m_spokes * 2 * CV_PI - CV_PI);
+            int const x(min(max(static_cast<int>(cx + r * cos(a) * cx), 0), m_size.width - 1)),
+                      y(min(max(static_cast<int>(cy + r * sin(a) * cy), 0), m_size.height - 1));
+            m_centres.push_back(Point(x, y));
+        } else {
+            m_centres.push_back(Point(-1, -1));
+        }
+    }
+}
+
+void FoveatedSampler::sample(Mat const& crop, Mat& electrodes) const {
+    if(crop.type() != CV_8UC1 || crop.size() != m_size || crop.empty()) {
+        return;
+    }
+
+    vector<uint32_t> sums(m_rings * m_spokes, 0);
+
+    //One pass over the rows, every run being a plain contiguous sum
+    for(int y(0); y < m_size.height; ++y) {
+        uchar const* row(crop.ptr<uchar>(y));
+        for(size_t i(m_rowStart[y]); i < m_rowStart[y + 1]; ++i) {
+            Run const& run(m_runs[i]);
+            uchar const* p(row + run.x);
+            uint32_t sum(0);
+            for(int x(0); x < run.length; ++x) {
+                sum += p[x];
+            }
+            sums[run.electrode] += sum;
+        }
+    }
+
+    electrodes.create(m_rings, m_spokes, CV_8UC1);
+    uchar* out(electrodes.ptr<uchar>(0));
+    for(size_t e(0); e < sums.size(); ++e) {
+        Point const centre(m_centres[e]);
+        out[e] = centre.x < 0 ? m_divisors[e].divide(sums[e]) : crop.at<uchar>(centre);
+    }
+}
+
+void FoveatedSampler::reverse(Mat& electrodes) const {
+    if(electrodes.empty()) {
+        return;
+    }
+
+    Mat reversed(electrodes.size(), electrodes.type());
+    int const half(electrodes.cols / 2);
+    for(int y(0); y < electrodes.rows; ++y) {
+        uchar const* in(electrodes.ptr<uchar>(y));
+        uchar* out(reversed.ptr<uchar>(y));
+        for(int x(0); x < electrodes.cols; ++x) {
+            out[(x + half) % electrodes.cols] = in[x];
+        }
+    }
+    electrodes = reversed;
+}
+
+void FoveatedSampler::render(Mat const& electrodes, Mat& img) const {
+    img.create(m_size, CV_8UC1);
+    img.setTo(Scalar(0));
+    if(electrodes.type() != CV_8UC1 || electrodes.rows != m_rings || electrodes.cols != m_spokes) {
+        return;
+    }
+
+    uchar const* values(electrodes.ptr<uchar>(0));
+    for(int y(0); y < m_size.height; ++y) {
+        uchar* row(img.ptr<uchar>(y));
+        for(size_t i(m_rowStart[y]); i < m_rowStart[y + 1]; ++i) {
+            Run const& run(m_runs[i]);
+            fill(row + run.x, row + run.x + run.length, values[run.electrode]);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef FOVEATED_H_INCLUDED
+#define FOVEATED_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "fixedpoint.h"
+#include "layoutcache.h"
+
+//Foveated layout : the electrodes sit on rings around the centre of the crop, like the cells of the retina.
+//The rings get wider with the eccentricity (log-polar), so the electrodes are dense in the centre and sparse
+//on the sides. Every electrode averages the pixels of its ring sector.
+//
+//The electrode frame is rings x spokes : row 0 is the inner ring, column 0 the spoke on the left of the
+//centre, the next ones going clockwise. Pixels out of the ellipse inscribed in the crop are not used.
+class FoveatedSampler {
+public:
+    //'fovea' : radius of the inner ring, as a fraction of the radius of the crop
+    explicit FoveatedSampler(double fovea = 0.1);
+
+    //The tables are only rebuilt when the crop size or the layout change. Returns true if they were.
+    //With a cache, they are taken from it when it has them, and added to it otherwise.
+    bool configure(cv::Size crop, int rings, int spokes);
+    void setCache(LayoutCache* cache) { m_cache = cache; }
+
+    //Average of every electrode, 'crop' being configure() size. 'electrodes' must not be 'crop'.
+    void sample(cv::Mat const& crop, cv::Mat& electrodes) const;
+
+    //Equivalent of reverseImage() : half a turn, rounded to a spoke when their number is odd
+    void reverse(cv::Mat& electrodes) const;
+
+    //Paint every sector with its electrode, in a picture of the crop size, to see the layout
+    void render(cv::Mat const& electrodes, cv::Mat& img) const;
+
+    int rings() const { return m_rings; }
+    int spokes() const { return m_spokes; }
+
+private:
+    //The runs and the row starts, the rest is derived from them
+    LayoutCache::Key cacheKey() const;
+    void saveTables(std::vector<uchar>& tables) const;
+    bool restoreTables(uchar const* tables, size_t size);
+    void computeDivisors();
+
+    //Consecutive pixels of a row belonging to the same electrode
+    struct Run {
+        uint16_t x;
+        uint16_t length;
+        uint32_t electrode;
+    };
+
+    double m_fovea;
+    cv::Size m_size;
+    int m_rings, m_spokes;
+    std::vector<Run> m_runs;
+    std::vector<size_t> m_rowStart;       //Runs of row y : [m_rowStart[y], m_rowStart[y + 1])
+    std::vector<BlockDivisor> m_divisors; //Pixels of every electrode
+    std::vector<cv::Point> m_centres;     //Pixel read by the electrodes too small to hold any
+    LayoutCache* m_cache;
+};
+
+#endif // FOVEATED_H_INCLUDED
@@ -0,0 +1,88 @@
+#include "frameview.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "fixedpoint.h"
+
+using namespace cv;
+using namespace std;
+
+int bytesPerPixel(PixelFormat format) {
+    switch(format) {
+        case PIXEL_GRAY8: return 1;
+        case PIXEL_BGR24: return 3;
+        case PIXEL_BGRA32: return 4;
+        case PIXEL_YUYV: return 2;
+        case PIXEL_NV12: return 1;
+    }
+    return 0;
+}
+
+bool validView(FrameView const& frame) {
+    int const bytes(bytesPerPixel(frame.format));
+    return frame.data && bytes > 0 && frame.width > 0 && frame.height > 0
+           && frame.stride >= static_cast<size_t>(frame.width) * bytes;
+}
+
+bool pixeliseView(FrameView const& frame, Rect crop, int electrodes_w, int electrodes_h, ElectrodeView const& electrodes) {
+    crop &= Rect(0, 0, frame.width, frame.height);
+    if(!validView(frame) || crop.area() == 0 || !electrodes.data) {
+        return false;
+    }
+
+    electrodes_w = min(max(electrodes_w, 1), crop.width);
+    electrodes_h = min(max(electrodes_h, 1), crop.height);
+    if(electrodes.width != electrodes_w || electrodes.height != electrodes_h) {
+        return false;
+    }
+
+    int const blockW(crop.width / electrodes_w),
+              blockH(crop.height / electrodes_h),
+              bytes(bytesPerPixel(frame.format));
+    //The C interface lets a whole frame be one block : above the ~11 million pixels of BlockDivisor, a true division
+    uint64_t const pixels(static_cast<uint64_t>(blockW) * blockH);
+    bool const exact(pixels <= 11000000);
+    BlockDivisor const divisor(exact ? static_cast<uint32_t>(pixels) : 1);
+
+    //Luma of the pixels used, for the formats which do not have it as consecutive bytes
+    vector<uchar> luma(frame.format == PIXEL_GRAY8 || frame.format == PIXEL_NV12 ? 0 : blockW * electrodes_w);
+    vector<uint64_t> sums(electrodes_w);
+
+    for(int by(0); by < electrodes_h; ++by) {
+        fill(sums.begin(), sums.end(), 0);
+
+        for(int y(crop.y + by * blockH); y < crop.y + (by + 1) * blockH; ++y) {
+            uchar const* p(frame.data + y * frame.stride + crop.x * bytes);
+            switch(frame.format) {
+                case PIXEL_BGR24:
+                case PIXEL_BGRA32:
+                    convertRowToGrayScaleFixed(p, bytes, static_cast<int>(luma.size()), luma.data());
+                    p = luma.data();
+                    break;
+                case PIXEL_YUYV:
+                    for(size_t x(0); x < luma.size(); ++x) {
+                        luma[x] = p[2 * x];
+                    }
+                    p = luma.data();
+                    break;
+                default:
+                    break;
+            }
+
+            for(int bx(0); bx < electrodes_w; ++bx, p += blockW) {
+                uint64_t sum(0);
+                for(int x(0); x < blockW; ++x) {
+                    sum += p[x];
+                }
+                sums[bx] += sum;
+            }
+        }
+
+        uint8_t* out(electrodes.data + by * electrodes.stride);
+        for(int bx(0); bx < electrodes_w; ++bx) {
+            out[bx] = exact ? divisor.divide(sums[bx]) : static_cast<uint8_t>(sums[bx] / pixels);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef FRAMEVIEW_H_INCLUDED
+#define FRAMEVIEW_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+//Frames and electrodes in memory owned by someone else (the buffers of a camera driver, of a host process),
+//read and written where they are, without a Mat around them.
+
+//Layouts of the frames
+enum PixelFormat {
+    PIXEL_GRAY8,
+    PIXEL_BGR24,
+    PIXEL_BGRA32,
+    PIXEL_YUYV,  //Packed 4:2:2, Y on the even bytes
+    PIXEL_NV12   //'data' is the Y plane, the UV plane after it is not read
+};
+
+//'stride' : bytes from the start of a row to the next one
+struct FrameView {
+    uint8_t const* data;
+    int width, height;
+    size_t stride;
+    PixelFormat format;
+};
+
+//Electrode grid, one byte per electrode
+struct ElectrodeView {
+    uint8_t* data;
+    int width, height;
+    size_t stride;
+};
+
+//Bytes of a pixel in a row (of the Y plane for NV12), 0 for an unknown format
+int bytesPerPixel(PixelFormat format);
+
+//Enough bytes for its rows and a known format
+bool validView(FrameView const& frame);
+
+//Grayscale and pixelise of the 'crop' part of the frame in one pass, row by row : only the crop is read,
+//and nothing bigger than one row of luma is written besides the electrodes.
+//Same electrodes as convertImageToGrayScaleFixed() then pixeliseImageFixed() on the crop,
+//the grid being clamped the same way : 'electrodes' must be that size.
+bool pixeliseView(FrameView const& frame, cv::Rect crop, int electrodes_w, int electrodes_h, ElectrodeView const& electrodes);
+
+#endif // FRAMEVIEW_H_INCLUDED
@@ -0,0 +1,225 @@
+#include "gaze.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+GazeSource::GazeSource() : m_socket(-1), m_samples(0) {
+    m_gaze.x = 0;
+    m_gaze.y = 0;
+}
+
+GazeSource::~GazeSource() {
+    close();
+}
+
+bool GazeSource::openFile(string const& filename) {
+    close();
+
+    m_file.open(filename.c_str());
+    if(!m_file) {
+        cout << "Gaze : could not open " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+#ifndef _WIN32
+
+bool GazeSource::openUdp(int port) {
+    close();
+
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if(m_socket < 0) {
+        cout << "Gaze : could not create the socket" << endl;
+        return false;
+    }
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if(bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        cout << "Gaze : could not listen on port " << port << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void GazeSource::close() {
+    if(m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    if(m_file.is_open()) {
+        m_file.close();
+    }
+    m_partial.clear();
+}
+
+#else
+
+bool GazeSource::openUdp(int port) {
+    cout << "Gaze : UDP input is only available on POSIX systems, port " << port << " not used" << endl;
+    return false;
+}
+
+void GazeSource::close() {
+    if(m_file.is_open()) {
+        m_file.close();
+    }
+    m_partial.clear();
+}
+
+#endif
+
+bool GazeSource::isOpen() const {
+    return m_socket >= 0 || m_file.is_open();
+}
+
+bool GazeSource::parse(string const& line) {
+    float x(0), y(0);
+    if(sscanf(line.c_str(), "%f %f", &x, &y) != 2) {
+        return false;
+    }
+
+    m_gaze.x = min(max(x, -1.0f), 1.0f);
+    m_gaze.y = min(max(y, -1.0f), 1.0f);
+    ++m_samples;
+    return true;
+}
+
+GazeOffset GazeSource::poll() {
+    if(m_file.is_open()) {
+        //The last line may not be complete yet, it is finished on the next call
+        string line;
+        while(getline(m_file, line)) {
+            if(m_file.eof()) {
+                m_partial += line;
+                break;
+            }
+            parse(m_partial + line);
+            m_partial.clear();
+        }
+        m_file.clear();
+    }
+
+#ifndef _WIN32
+    if(m_socket >= 0) {
+        char buffer[256];
+        ssize_t size;
+        while((size = recv(m_socket, buffer, sizeof(buffer) - 1, MSG_DONTWAIT)) > 0) {
+            buffer[size] = '\0';
+            parse(buffer);
+        }
+    }
+#endif
+
+    return m_gaze;
+}
+
+bool SamplingPlanner::Geometry::operator!=(Geometry const& other) const {
+    return cols != other.cols || rows != other.rows || angle != other.angle
+        || electrodes_w != other.electrodes_w || electrodes_h != other.electrodes_h;
+}
+
+SamplingPlanner::SamplingPlanner(int steps) : m_steps(max(steps, 1)), m_built(0) {
+    memset(&m_geometry, 0, sizeof(m_geometry));
+}
+
+SamplingPlan const& SamplingPlanner::plan(Size frame, int angle, int electrodes_w, int electrodes_h, GazeOffset gaze) {
+    Geometry geometry = {frame.width, frame.height, angle, electrodes_w, electrodes_h};
+    if(geometry != m_geometry) {
+        m_plans.clear();
+        m_geometry = geometry;
+    }
+
+    pair<int, int> key(cvRound(min(max(gaze.x, -1.0f), 1.0f) * m_steps),
+                       cvRound(min(max(gaze.y, -1.0f), 1.0f) * m_steps));
+    map<pair<int, int>, SamplingPlan>::iterator found(m_plans.find(key));
+    if(found != m_plans.end()) {
+        return found->second;
+    }
+
+    //Centred crop of reduceImage(), moved into the free room on the side the eye looks at
+    SamplingPlan plan;
+    Rect centred(reduceRectFixed(frame.width, frame.height, angle, electrodes_w, electrodes_h));
+    int roomX(key.first < 0 ? centred.x : frame.width - centred.x - centred.width),
+        roomY(key.second < 0 ? centred.y : frame.height - centred.y - centred.height);
+    plan.crop = centred + Point(key.first * roomX / m_steps, key.second * roomY / m_steps);
+
+    //Same rules as pixeliseImage()
+    plan.electrodes_w = min(max(electrodes_w, 1), max(plan.crop.width, 1));
+    plan.electrodes_h = min(max(electrodes_h, 1), max(plan.crop.height, 1));
+    plan.blockW = plan.crop.width / plan.electrodes_w;
+    plan.blockH = plan.crop.height / plan.electrodes_h;
+    plan.divisor = BlockDivisor(plan.blockW * plan.blockH);
+    plan.columns.resize(plan.electrodes_w);
+    for(int x(0); x < plan.electrodes_w; ++x) {
+        plan.columns[x] = x * plan.blockW;
+    }
+
+    ++m_built;
+    return m_plans.insert(make_pair(key, plan)).first->second;
+}
+
+namespace {
+
+//Channels known at compile time : the gray loop stays as tight as it was
+template<int CHANNELS>
+void sampleChannels(Mat const& crop, SamplingPlan const& plan, Mat& electrodes) {
+    electrodes.create(plan.electrodes_h, plan.electrodes_w, CV_8UC(CHANNELS));
+    vector<uint32_t> sums(plan.electrodes_w * CHANNELS);
+
+    for(int by(0); by < plan.electrodes_h; ++by) {
+        fill(sums.begin(), sums.end(), 0);
+
+        for(int y(by * plan.blockH); y < (by + 1) * plan.blockH; ++y) {
+            uchar const* row(crop.ptr<uchar>(y));
+            for(int bx(0); bx < plan.electrodes_w; ++bx) {
+                uchar const* p(row + plan.columns[bx] * CHANNELS);
+                uint32_t sum[CHANNELS] = {};
+                for(int x(0); x < plan.blockW * CHANNELS; x += CHANNELS) {
+                    for(int c(0); c < CHANNELS; ++c) {
+                        sum[c] += p[x + c];
+                    }
+                }
+                for(int c(0); c < CHANNELS; ++c) {
+                    sums[bx * CHANNELS + c] += sum[c];
+                }
+            }
+        }
+
+        uchar* out(electrodes.ptr<uchar>(by));
+        for(int i(0); i < plan.electrodes_w * CHANNELS; ++i) {
+            out[i] = plan.divisor.divide(sums[i]);
+        }
+    }
+}
+
+}
+
+void sampleElectrodes(Mat const& crop, SamplingPlan const& plan, Mat& electrodes) {
+    if(crop.cols != plan.crop.width || crop.rows != plan.crop.height || crop.empty()) {
+        return;
+    }
+
+    if(crop.type() == CV_8UC1) {
+        sampleChannels<1>(crop, plan, electrodes);
+    } else if(crop.type() == CV_8UC3) {
+        sampleChannels<3>(crop, plan, electrodes);
+    }
+}
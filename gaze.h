@@ -0,0 +1,95 @@
+#ifndef GAZE_H_INCLUDED
+#define GAZE_H_INCLUDED
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "fixedpoint.h"
+
+//Gaze-contingent sampling : the crop of reduceImage() follows the eye instead of staying centred.
+
+//Where the eye looks, from -1 to 1 on each axis : -1 moves the crop against the left (top) border,
+//1 against the right (bottom) one, 0 keeps it centred.
+struct GazeOffset {
+    float x;
+    float y;
+};
+
+const int GAZE_DEFAULT_PORT = 5006;
+
+//Stand-in for the eye tracker : lines or datagrams "x y", only the latest one matters
+class GazeSource {
+public:
+    GazeSource();
+    ~GazeSource();
+
+    //A file the tracker appends to
+    bool openFile(std::string const& filename);
+    //Datagrams sent to 127.0.0.1:port (POSIX only)
+    bool openUdp(int port = GAZE_DEFAULT_PORT);
+    void close();
+    bool isOpen() const;
+
+    //Read everything received since the last call, without waiting.
+    //Returns the latest offset (the previous one if nothing new arrived).
+    GazeOffset poll();
+
+    //Samples read so far
+    unsigned int samples() const { return m_samples; }
+
+private:
+    GazeSource(GazeSource const&);
+    GazeSource& operator=(GazeSource const&);
+
+    bool parse(std::string const& line);
+
+    std::ifstream m_file;
+    std::string m_partial; //Line not finished yet in the file
+    int m_socket;
+    GazeOffset m_gaze;
+    unsigned int m_samples;
+};
+
+//Everything needed to sample the electrodes for one gaze position : the crop in the frame,
+//where every electrode starts in it and the divisor of the averages
+struct SamplingPlan {
+    cv::Rect crop;
+    int electrodes_w, electrodes_h;
+    int blockW, blockH;
+    BlockDivisor divisor;
+    std::vector<int> columns; //x of the first pixel of every electrode column, in the crop
+};
+
+//Plans for the quantised gaze positions, built once and reused.
+//The crop moves by 1 / steps of the free room on each side, so a 1 kHz tracker costs a lookup per frame.
+class SamplingPlanner {
+public:
+    explicit SamplingPlanner(int steps = 32);
+
+    //The cache is emptied when the frame size, the angle or the electrodes change
+    SamplingPlan const& plan(cv::Size frame, int angle, int electrodes_w, int electrodes_h, GazeOffset gaze);
+
+    size_t plansBuilt() const { return m_built; }
+
+private:
+    struct Geometry {
+        int cols, rows, angle, electrodes_w, electrodes_h;
+        bool operator!=(Geometry const& other) const;
+    };
+
+    int m_steps;
+    Geometry m_geometry;
+    std::map<std::pair<int, int>, SamplingPlan> m_plans;
+    size_t m_built;
+};
+
+//pixeliseImage() of the crop of the plan, gray or BGR. 'crop' is the crop only, not the whole frame.
+void sampleElectrodes(cv::Mat const& crop, SamplingPlan const& plan, cv::Mat& electrodes);
+
+#endif // GAZE_H_INCLUDED
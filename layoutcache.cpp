@@ -0,0 +1,226 @@
+#include "layoutcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+char const magic[4] = {'B', 'E', 'L', 'C'};
+uint32_t const byteOrderMark = 0x01020304;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t tables;
+    uint32_t byteOrder;
+};
+
+size_t aligned(size_t bytes) {
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+}
+
+bool LayoutCache::Key::operator==(Key const& other) const {
+    return kind == other.kind && width == other.width && height == other.height
+           && rows == other.rows && cols == other.cols && parameter == other.parameter;
+}
+
+LayoutCache::LayoutCache() : m_data(nullptr), m_size(0) {
+}
+
+LayoutCache::~LayoutCache() {
+    close();
+}
+
+bool LayoutCache::open(string const& filename) {
+    close();
+    m_filename = filename;
+    return map();
+}
+
+void LayoutCache::close() {
+    unmap();
+    m_added.clear();
+    m_filename.clear();
+}
+
+bool LayoutCache::map() {
+#ifndef _WIN32
+    int fd(::open(m_filename.c_str(), O_RDONLY));
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if(fstat(fd, &status) != 0 || status.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data(mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+    ::close(fd);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    m_data = static_cast<uchar const*>(data);
+    m_size = status.st_size;
+#else
+    //No mmap() : read at once, still without planning anything
+    ifstream file(m_filename.c_str(), ios::binary);
+    if(!file) {
+        return false;
+    }
+    m_buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    if(m_buffer.empty()) {
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+
+    //Nothing is trusted : a damaged file only costs the planning
+    Header header;
+    bool valid(m_size >= sizeof(header));
+    if(valid) {
+        memcpy(&header, m_data, sizeof(header));
+        valid = memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == VERSION && header.byteOrder == byteOrderMark
+                && header.tables <= (m_size - sizeof(header)) / sizeof(Entry);
+    }
+    if(valid) {
+        m_entries.resize(header.tables);
+        if(!m_entries.empty()) {
+            memcpy(&m_entries[0], m_data + sizeof(header), m_entries.size() * sizeof(Entry));
+        }
+        for(Entry const& entry : m_entries) {
+            valid = valid && entry.offset <= m_size && entry.size <= m_size - entry.offset;
+        }
+    }
+
+    if(!valid) {
+        cout << m_filename << " : not a layout cache of version " << VERSION << ", the layouts will be planned again" << endl;
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+void LayoutCache::unmap() {
+#ifndef _WIN32
+    if(m_data != nullptr) {
+        munmap(const_cast<uchar*>(m_data), m_size);
+    }
+#else
+    m_buffer.clear();
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_entries.clear();
+}
+
+bool LayoutCache::find(Key const& key, uchar const*& data, size_t& size) const {
+    for(auto const& added : m_added) {
+        if(added.first == key) {
+            data = added.second.data();
+            size = added.second.size();
+            return true;
+        }
+    }
+    for(Entry const& entry : m_entries) {
+        if(entry.key == key) {
+            data = m_data + entry.offset;
+            size = entry.size;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LayoutCache::add(Key const& key, vector<uchar> const& data) {
+    for(auto& added : m_added) {
+        if(added.first == key) {
+            added.second = data;
+            return;
+        }
+    }
+    m_added.push_back(make_pair(key, data));
+}
+
+bool LayoutCache::save() {
+    if(m_added.empty() || m_filename.empty()) {
+        return true;
+    }
+
+    //The tables of the file which were not computed again, then the new ones
+    vector<Entry> entries;
+    vector<uchar const*> tables;
+    for(Entry const& entry : m_entries) {
+        bool replaced(false);
+        for(auto const& added : m_added) {
+            replaced = replaced || added.first == entry.key;
+        }
+        if(!replaced) {
+            entries.push_back(entry);
+            tables.push_back(m_data + entry.offset);
+        }
+    }
+    for(auto const& added : m_added) {
+        Entry entry = {added.first, 0, added.second.size()};
+        entries.push_back(entry);
+        tables.push_back(added.second.data());
+    }
+
+    size_t offset(aligned(sizeof(Header) + entries.size() * sizeof(Entry)));
+    for(Entry& entry : entries) {
+        entry.offset = offset;
+        offset = aligned(offset + entry.size);
+    }
+
+    //Written aside then renamed : a session stopped in the middle leaves the previous file
+    string const temporary(m_filename + ".tmp");
+    {
+        ofstream file(temporary.c_str(), ios::binary | ios::trunc);
+        Header header;
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = VERSION;
+        header.tables = static_cast<uint32_t>(entries.size());
+        header.byteOrder = byteOrderMark;
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(entries.data()), entries.size() * sizeof(Entry));
+
+        char const padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        size_t written(sizeof(header) + entries.size() * sizeof(Entry));
+        for(size_t i(0); i < entries.size(); ++i) {
+            file.write(padding, entries[i].offset - written);
+            file.write(reinterpret_cast<char const*>(tables[i]), entries[i].size);
+            written = entries[i].offset + entries[i].size;
+        }
+        if(!file) {
+            cout << "Could not write " << temporary << endl;
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    unmap();
+    remove(m_filename.c_str()); //rename() does not replace on Windows
+    if(rename(temporary.c_str(), m_filename.c_str()) != 0) {
+        cout << "Could not write " << m_filename << endl;
+        return false;
+    }
+    cout << m_added.size() << " layouts saved in " << m_filename << endl;
+    m_added.clear();
+    return map();
+}
@@ -0,0 +1,76 @@
+#ifndef LAYOUTCACHE_H_INCLUDED
+#define LAYOUTCACHE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//Tables derived from a profile which take a while to compute (the sampling map of a foveated layout),
+//kept in a binary file next to the profile. The file is memory mapped when opened, so a session starting
+//with a complex layout only reads the tables it uses instead of planning them again.
+//
+//Layout of the file, native byte order (the cache is rebuilt on another machine rather than converted) :
+//  header  : "BELC", version, number of tables, byte order mark
+//  entries : key, offset and size of every table
+//  tables  : 8 bytes aligned
+//A file of another version, byte order or damaged is ignored : everything is computed again and saved over it.
+class LayoutCache {
+public:
+    //Increased whenever a table changes its layout
+    static const uint32_t VERSION = 1;
+
+    enum Kind {
+        FOVEATED_LAYOUT = 1
+    };
+
+    struct Key {
+        uint32_t kind;
+        int32_t width, height; //Picture the table is for
+        int32_t rows, cols;    //Electrodes
+        uint32_t reserved;
+        double parameter;      //Fovea for the foveated layouts
+
+        bool operator==(Key const& other) const;
+    };
+
+    LayoutCache();
+    ~LayoutCache();
+
+    bool open(std::string const& filename);
+    void close();
+
+    //Table of 'key', pointing into the mapping (or into the tables added since) until close() or save()
+    bool find(Key const& key, uchar const*& data, size_t& size) const;
+
+    //Kept in memory until save()
+    void add(Key const& key, std::vector<uchar> const& data);
+
+    //Writes the file again if tables were added, then maps it again
+    bool save();
+
+private:
+    LayoutCache(LayoutCache const&);
+    LayoutCache& operator=(LayoutCache const&);
+
+    struct Entry {
+        Key key;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    bool map();
+    void unmap();
+
+    std::string m_filename;
+    uchar const* m_data; //Whole file
+    size_t m_size;
+    std::vector<uchar> m_buffer; //The file read in memory where it cannot be mapped
+    std::vector<Entry> m_entries;
+
+    std::vector<std::pair<Key, std::vector<uchar> > > m_added;
+};
+
+#endif // LAYOUTCACHE_H_INCLUDED
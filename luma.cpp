@@ -0,0 +1,68 @@
+#include "luma.h"
+
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+
+namespace {
+
+int const fourccUyvy('U' | ('Y' << 8) | ('V' << 16) | ('Y' << 24));
+
+//Copy the Y of a packed 4:2:2 frame, 'offset' being the position of Y in a pair of bytes
+void copyPackedLuma(Mat const& packed, Rect crop, int offset, Mat& gray) {
+    gray.create(crop.height, crop.width, CV_8UC1);
+    for(int y(0); y < crop.height; ++y) {
+        uchar const* p(packed.ptr<uchar>(crop.y + y) + crop.x * 2 + offset);
+        uchar* out(gray.ptr<uchar>(y));
+        for(int x(0); x < crop.width; ++x) {
+            out[x] = p[2 * x];
+        }
+    }
+}
+
+}
+
+LumaSource extractLuma(Mat const& raw, int fourcc, Size frameSize, Rect crop, Mat& gray) {
+    int const w(frameSize.width), h(frameSize.height);
+    crop &= Rect(0, 0, w, h);
+    if(raw.empty() || crop.area() == 0) {
+        return LUMA_UNAVAILABLE;
+    }
+
+    //The backend ignored CAP_PROP_CONVERT_RGB
+    if(raw.type() == CV_8UC3 && raw.cols == w && raw.rows == h) {
+        cvtColor(Mat(raw, crop), gray, COLOR_BGR2GRAY);
+        return LUMA_FROM_BGR;
+    }
+
+    int const offset(fourcc == fourccUyvy ? 1 : 0);
+
+    //Packed 4:2:2, as 2 channels
+    if(raw.type() == CV_8UC2 && raw.cols == w && raw.rows == h) {
+        copyPackedLuma(raw, crop, offset, gray);
+        return LUMA_FROM_PACKED;
+    }
+
+    if(raw.depth() != CV_8U || !raw.isContinuous()) {
+        return LUMA_UNAVAILABLE;
+    }
+
+    //Otherwise the backend gives the bytes of the buffer, the layout is guessed from their number
+    size_t const bytes(raw.total() * raw.elemSize()),
+                 pixels(static_cast<size_t>(w) * h);
+    uchar* data(const_cast<uchar*>(raw.ptr<uchar>(0)));
+
+    if(bytes == pixels) {
+        gray = Mat(Mat(h, w, CV_8UC1, data), crop);
+        return LUMA_FROM_GRAY;
+    } else if(bytes == pixels * 3 / 2) {
+        //NV12, I420 and YV12 all start with the full Y plane
+        gray = Mat(Mat(h, w, CV_8UC1, data), crop);
+        return LUMA_FROM_Y_PLANE;
+    } else if(bytes == pixels * 2) {
+        copyPackedLuma(Mat(h, w, CV_8UC2, data), crop, offset, gray);
+        return LUMA_FROM_PACKED;
+    }
+
+    return LUMA_UNAVAILABLE;
+}
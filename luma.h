@@ -0,0 +1,21 @@
+#ifndef LUMA_H_INCLUDED
+#define LUMA_H_INCLUDED
+
+#include <opencv2/core.hpp>
+
+//Grayscale taken straight from the Y of the camera buffers (CAP_PROP_CONVERT_RGB disabled),
+//instead of YUV -> BGR in the backend and BGR -> gray in convertImageToGrayScale().
+
+enum LumaSource {
+    LUMA_UNAVAILABLE,   //Unknown layout (MJPEG bytes for instance) : the conversion must be turned back on
+    LUMA_FROM_Y_PLANE,  //NV12, I420, YV12 : the result points into the camera buffer, nothing copied
+    LUMA_FROM_PACKED,   //YUYV, UYVY : one byte out of two copied
+    LUMA_FROM_GRAY,     //The camera already gives gray
+    LUMA_FROM_BGR       //The backend converted anyway, fallback on cvtColor
+};
+
+//Luma of the 'crop' part of a raw frame of frameSize pixels, in the layout given by 'fourcc'.
+//'raw' is whatever VideoCapture::read() returned. 'gray' must not be 'raw'.
+LumaSource extractLuma(cv::Mat const& raw, int fourcc, cv::Size frameSize, cv::Rect crop, cv::Mat& gray);
+
+#endif // LUMA_H_INCLUDED
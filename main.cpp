@@ -1,142 +1,435 @@
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include <opencv2/opencv.hpp>
 
+#include "captureconfig.h"
+#include "contrast.h"
+#include "defects.h"
+#include "display.h"
+#include "edges.h"
+#include "fixedpoint.h"
+#include "foveated.h"
+#include "gaze.h"
+#include "layoutcache.h"
+#include "luma.h"
+#include "multicam.h"
+#include "pipeline.h"
+#include "pixelisekernels.h"
+#include "processing.h"
+#include "profile.h"
+#include "pyramid.h"
+#include "quantize.h"
+#include "recording.h"
+#include "scheduler.h"
+#include "selfcheck.h"
+#include "shmring.h"
+#include "spread.h"
+#include "stages.h"
+#include "streaming.h"
+#include "timing.h"
+#include "udpstream.h"
+
 using namespace cv;
 using namespace std;
 
-bool loadImage(Mat& img, string filename) {
-    img = imread(filename.c_str(), IMREAD_COLOR);
-
-    if(img.empty()) {
-        cout << "Could not open or find image : " << filename << endl;
-        return false;
-    } else {
-        cout << "Opened : " << filename << endl;
-        return true;
+//The webcam path, on a camera or on a recording (ReplayCapture).
+//'headless' : no window, the trackbars keep the values of the profile and the frames run until the source ends.
+void runCamera(VideoCapture& webcam, bool headless) {
+    Mat frame;
+    if(!webcam.read(frame)) {
+        cout << "No frame" << endl;
+        return;
     }
-}
+    int height(frame.size().height);
+    int width(frame.size().width);
 
-void convertImageToGrayScale(Mat& img) {
-    cvtColor(img, img, COLOR_BGR2GRAY);
-}
+    //Settings of the last session, 'p' to keep the current ones
+    string const profileName("profile.txt");
+    Profile profile;
+    profile.load(profileName);
 
-void reduceImage(Mat& img, int angle, double scale) {
-    int w(img.cols * angle / 100),
-        h(w * scale),
-        x((img.cols - w) / 2),
-        y((img.rows - h) / 2);
+    //Windows, trackbars and keys are handled by their own thread, at their own rate
+    DisplayThread display;
+    int modifiedWindow(display.addWindow("Modified picture"));
+    int initialWindow(display.addWindow("Initial picture")); //'i' to hide or show
+    int reduceWindow(display.addWindow("Reduced picture")); //'r' to hide or show
 
-    //Avoid matrix of 0 x i
-    if(w == 0 || h == 0) {
-        return;
+    //Add some trackbars
+    int widthBar(display.addTrackbar("width", modifiedWindow, profile.electrodes_w, width)); //Number of electrodes
+    int heightBar(display.addTrackbar("height", modifiedWindow, profile.electrodes_h, height));
+    int angleBar(display.addTrackbar("angle (%)", modifiedWindow, profile.angle, 100)); //Percentage of the width of the initial picture which will be used
+    int zoomBar(display.addTrackbar("zoom", modifiedWindow, profile.zoom, 20)); //time to extend the final picture
+    int smoothingBar(display.addTrackbar("smoothing (%)", modifiedWindow, profile.smoothing, 99)); //Percentage of the previous electrode frame kept in the new one
+    int levelsBar(display.addTrackbar("levels", modifiedWindow, profile.levels, 256)); //Current levels supported by the electrodes
+    int gammaBar(display.addTrackbar("gamma (x10)", modifiedWindow, profile.gamma, 30)); //Transfer curve from gray to level
+    int spreadBar(display.addTrackbar("spread (x10)", modifiedWindow, profile.spread, 30)); //Current spread around an electrode, in tenths of the electrode spacing
+    int edgeBar(display.addTrackbar("edge gain", modifiedWindow, profile.edgeGain, 8)); //Only with the edges ('o')
+    int rateBar(display.addTrackbar("display (Hz)", modifiedWindow, profile.displayRate, 60));
+    int deadlineBar(display.addTrackbar("deadline (ms)", modifiedWindow, profile.deadline, 200)); //0 : the camera period
+    if(!headless) {
+        display.start();
     }
 
-    if(w + x > img.cols) {
-        img = Mat(img, Rect(0, y, img.cols, h));
-    } else if(h + y> img.rows) {
-        img = Mat(img, Rect(x, 0, w, img.rows));
-    } else {
-        img = Mat(img, Rect(x, y, w, h));
+    //Electrode frames are also published for the other local processes (see ShmReader),
+    //with room for the BGR electrodes ('k')
+    ShmPublisher publisher;
+    if(publisher.open("/bionic_eye", width, height, 8, 3)) {
+        cout << "Electrode frames published in /bionic_eye" << endl;
     }
-}
 
-//No more imagination, sorry
-//Need the picture in gray scale
-void pixeliseImage(Mat& img, int electrodes_w, int electrodes_h) {
-    //To avoid errors
-    if(img.channels() != 1) {
-        cout << "Too more channels. Channel expected 1." << endl;
-        return;
+    //And sent to the stimulator (see UdpReceiver for a stand-in)
+    UdpStreamer streamer;
+    if(streamer.open("127.0.0.1", UDP_DEFAULT_PORT, width, height, 1400, 3)) {
+        cout << "Electrode frames sent to 127.0.0.1:" << UDP_DEFAULT_PORT << endl;
     }
 
-    if(electrodes_w == 0) {
-        electrodes_w = 1;
-    } else if(electrodes_w > img.cols) {
-        electrodes_w = img.cols;
-    }
-    if(electrodes_h == 0) {
-        electrodes_h = 1;
-    } else if(electrodes_h > img.rows) {
-        electrodes_h = img.rows;
+    //The camera resolution follows the electrodes
+    CaptureNegotiator negotiator(webcam);
+
+    //Latency first : the quality goes down when the frames take longer than the deadline
+    DeadlineScheduler scheduler;
+    double const cameraPeriod(DeadlineScheduler::deadlineFromFps(webcam.get(CAP_PROP_FPS)));
+
+    bool carryOn(true);
+    bool mustSave(false);
+    bool integerPipeline(profile.integer); //'f' : integers only, as on the wearable processor
+    TemporalFilterFixed temporalFilter;
+    Quantizer quantizer;
+    DitherMode dither(static_cast<DitherMode>(profile.dither % 3)); //'d' to change
+    Mat stimulation;
+    vector<uchar> packed;
+    bool rawLuma(false); //'y' : gray straight from the Y of the camera buffers
+    Size rawSize;
+    int rawFourcc(0);
+    bool gazeContingent(profile.gaze); //'g' : the crop follows the eye tracker
+    GazeSource gaze;
+    if(gazeContingent && !gaze.openFile("gaze.txt")) {
+        gaze.openUdp();
     }
+    SamplingPlanner planner;
+    bool foveatedLayout(profile.foveated); //'l' : electrodes on rings, dense in the centre
+    FoveatedSampler foveated(profile.fovea);
+    LayoutCache layouts; //The sampling maps of the previous sessions, not planned again
+    layouts.open(layoutCacheName(profileName));
+    foveated.setCache(&layouts);
+    Mat layout;
+    CurrentSpread currentSpread;
+    DefectMap defects; //'e' : simulate the defective electrodes of the profile (defects.txt)
+    string const defectsName(profile.defects.empty() ? string("defects.txt") : profile.defects);
+    bool useDefects(!profile.defects.empty() && defects.load(defectsName));
+    EdgeMode edgeMode(static_cast<EdgeMode>(profile.edgeMode % 3)); //'o' to change
+    bool autoContrast(profile.autoContrast); //'a' : dim scenes use all the levels too
+    ColourMode colourMode(static_cast<ColourMode>(profile.colourMode % 3)); //'k' to change
+    AdaptiveContrast contrast;
+    FrameRecorder recorder; //'c' : the frames as captured, for ReplayCapture
+
+    //Frame times and what came out, to compare two builds on the same recording
+    vector<uint64_t> frameTimes;
+    size_t skipped(0);
+    uint64_t checksum(14695981039346656037ull); //FNV-1a of the electrode frames
+
+    //The steps to run follow the keys below, the pipeline is built again when one of them changes
+    Pipeline pipeline;
+    bool rebuild(true);
+    Mat electrodes;
+    Mat kept; //Picture the electrodes see, for the reduced window
+    auto buildPipeline = [&]() {
+        pipeline.clear(rawLuma ? FRAME_RAW : FRAME_BGR);
+        //Only the uniform grid averages the channels, the other samplings need the gray of every pixel
+        bool const edges(edgeMode != EDGE_NONE && !scheduler.degraded(DEGRADE_EDGES));
+        bool const colour(colourMode != COLOUR_GRAY && !rawLuma && !foveatedLayout && !edges);
+        //BGR to the output : the contrast and the current spread only know gray electrodes
+        bool const colourElectrodes(colour && colourMode == COLOUR_ELECTRODES);
+        if(rawLuma) {
+            pipeline.add(new RawLumaStage);
+        } else {
+            if(!colour) {
+                pipeline.add(new GrayStage(integerPipeline));
+            }
+            pipeline.add(new ReduceStage(integerPipeline));
+        }
 
-    Mat finalImg(electrodes_h, electrodes_w, CV_8UC1);
-    int blockW(img.cols / electrodes_w),
-        blockH(img.rows / electrodes_h);
+        if(foveatedLayout) {
+            pipeline.add(new FoveatedStage(foveated));
+        } else if(edges) {
+            pipeline.add(new EdgesStage(edgeMode));
+        } else {
+            pipeline.add(new PixeliseStage(integerPipeline, useDefects ? &defects : nullptr));
+        }
+        if(colour && !colourElectrodes) {
+            pipeline.add(new LumaStage(integerPipeline));
+        }
 
-    //Need to cut the big picture in several small picture
-    for(int x(0); x < electrodes_w; ++x) {
-        for(int y(0); y < electrodes_h; ++y) {
+        if(autoContrast && !colourElectrodes) {
+            pipeline.add(new ContrastStage(contrast, useDefects ? &defects : nullptr));
+        }
+        if(useDefects) {
+            pipeline.add(new DefectStage(defects));
+        }
+        pipeline.add(new TemporalStage(temporalFilter));
+        if(!colourElectrodes) {
+            pipeline.add(new SpreadStage(currentSpread, foveatedLayout));
+        }
+        pipeline.add(new ReverseStage(foveatedLayout ? &foveated : nullptr));
+        pipeline.add(new QuantizeStage(quantizer, dither, stimulation));
 
-            //Now let's do the average of fray of the target part
-            Mat target(img, Rect(blockW * x, blockH * y, blockW, blockH));
+        if(pipeline.compile()) {
+            cout << pipeline.describe();
+        }
+    };
+    pipeline.setObserver([&](size_t step, Stage const& stage, Mat const& img) {
+        //A copy : the crop is a view of the capture buffer, which the next read() fills again.
+        //Only when the display wants it, most frames are never shown.
+        if((stage.name() == "grayscale" || stage.name() == "reduce") && display.wants(reduceWindow)) {
+            img.copyTo(kept);
+        }
+        if(mustSave) {
+            Mat saved(img);
+            saveImage(to_string(step + 1) + "_" + stage.name(), saved);
+        }
+    });
 
-            int nRows(target.rows),
-                nCols(target.cols * target.channels()),
-                sum(0);
+    while(carryOn) {
+        //Input handling, the keys come from the display thread
+        switch((char)display.takeKey()) {
+            case 27:
+                carryOn = false;
+                break;
 
-            if(target.isContinuous()) {
-                nCols *= nRows;
-                nRows = 1;
-            }
+            case 115:
+                mustSave = true;
+                break;
 
-            uchar* p(nullptr);
-            for(int i(0); i < nRows; ++i) {
-                p = target.ptr<uchar>(i);
-                for(int j(0); j < nCols; ++j) {
-                    sum += p[j];
+            case 102:
+                integerPipeline = !integerPipeline;
+                rebuild = true;
+                cout << (integerPipeline ? "Integer pipeline" : "Reference pipeline") << endl;
+                break;
+
+            case 100:
+                dither = static_cast<DitherMode>((dither + 1) % 3);
+                rebuild = true;
+                cout << (dither == DITHER_NONE ? "No dithering" : dither == DITHER_ORDERED ? "Ordered dithering" : "Error diffusion") << endl;
+                break;
+
+            case 121:
+                rawLuma = !rawLuma;
+                rebuild = true;
+                //Backends which cannot do it keep giving BGR, extractLuma() copes with that
+                webcam.set(CAP_PROP_CONVERT_RGB, rawLuma ? 0 : 1);
+                negotiator.setUncompressed(rawLuma);
+                cout << (rawLuma ? "Luma from the camera buffers" : "Luma from BGR") << endl;
+                break;
+
+            case 103:
+                gazeContingent = !gazeContingent;
+                //gaze.txt if the tracker writes there, datagrams otherwise
+                if(gazeContingent && !gaze.isOpen() && !gaze.openFile("gaze.txt")) {
+                    gaze.openUdp();
                 }
-            }
+                cout << (gazeContingent ? "Gaze-contingent sampling" : "Centred sampling") << endl;
+                break;
 
-            uchar average(sum / (blockH * blockW));
+            case 108:
+                foveatedLayout = !foveatedLayout;
+                rebuild = true;
+                //The rings come from the same trackbars : height rings of width electrodes.
+                //Same frame size but other electrodes, the smoothing starts again.
+                temporalFilter.reset();
+                cout << (foveatedLayout ? "Foveated layout" : "Uniform grid") << endl;
+                break;
 
-            //Put this color in the target picture !
-            finalImg.ptr<uchar>(y)[x] = average;
-        }
-    }
+            case 101:
+                useDefects = !useDefects && (!defects.empty() || defects.load(defectsName));
+                rebuild = true;
+                cout << (useDefects ? "Defective electrodes" : "All electrodes working") << endl;
+                break;
 
-    img = finalImg;
-}
+            case 111:
+                edgeMode = static_cast<EdgeMode>((edgeMode + 1) % 3);
+                rebuild = true;
+                cout << (edgeMode == EDGE_NONE ? "Mean gray" : edgeMode == EDGE_SOBEL ? "Sobel edges" : "Laplacian edges") << endl;
+                break;
 
-//Reverse the mat send in argument (like if you look in a spoon)
-void reverseImage(Mat& img) {
-    //Temporary matrix
-    Mat finalImg(img.rows, img.cols, CV_8UC1);
+            case 97:
+                autoContrast = !autoContrast;
+                rebuild = true;
+                contrast.reset();
+                cout << (autoContrast ? "Automatic contrast" : "Fixed contrast") << endl;
+                break;
 
-    //The top-left corner pixel go the right-bottom corner
-    for(int y(0); y < img.rows; ++y) {
-        uchar* p = img.ptr<uchar>(y);
-        for(int x(0); x < img.cols; ++x) {
-            finalImg.ptr<uchar>(img.rows - y - 1)[img.cols - x - 1] = p[x];
+            case 99:
+                if(recorder.isOpen()) {
+                    recorder.close();
+                } else {
+                    recorder.open("recording.frames", webcam.get(CAP_PROP_FPS));
+                }
+                break;
+
+            case 112:
+                profile.electrodes_w = display.value(widthBar);
+                profile.electrodes_h = display.value(heightBar);
+                profile.angle = display.value(angleBar);
+                profile.zoom = display.value(zoomBar);
+                profile.foveated = foveatedLayout;
+                profile.defects = useDefects ? defectsName : string();
+                profile.levels = display.value(levelsBar);
+                profile.gamma = display.value(gammaBar);
+                profile.dither = dither;
+                profile.integer = integerPipeline;
+                profile.smoothing = display.value(smoothingBar);
+                profile.spread = display.value(spreadBar);
+                profile.edgeMode = edgeMode;
+                profile.edgeGain = display.value(edgeBar);
+                profile.autoContrast = autoContrast;
+                profile.colourMode = colourMode;
+                profile.gaze = gazeContingent;
+                profile.displayRate = display.value(rateBar);
+                profile.deadline = display.value(deadlineBar);
+                profile.save(profileName);
+                break;
+
+            case 107:
+                colourMode = static_cast<ColourMode>((colourMode + 1) % 3);
+                rebuild = true;
+                cout << (colourMode == COLOUR_GRAY ? "Grayscale, then averaged" : colourMode == COLOUR_WEIGHTED ? "Colour averaged, then weighted on the electrodes" : "Colour electrodes") << endl;
+                break;
+
+            case 105:
+                display.setVisible(initialWindow, !display.isVisible(initialWindow));
+                break;
+
+            case 114:
+                display.setVisible(reduceWindow, !display.isVisible(reduceWindow));
+                break;
+
+            default: break;
         }
-    }
 
-    img = finalImg;
-}
+        int electrodes_width(display.value(widthBar)),
+            electrodes_height(display.value(heightBar)),
+            angle(display.value(angleBar)),
+            zoom(display.value(zoomBar)),
+            smoothing(display.value(smoothingBar)),
+            levels(display.value(levelsBar)),
+            gamma(display.value(gammaBar)),
+            spread(display.value(spreadBar)),
+            edgeGain(display.value(edgeBar));
+        int deadline(display.value(deadlineBar));
+        scheduler.setDeadline(deadline > 0 ? deadline : cameraPeriod);
+        display.setRate(scheduler.displayRate(display.value(rateBar)));
+
+        //1 - Get picture, no bigger than what the electrodes need
+        negotiator.setPixelsPerElectrode(scheduler.pixelsPerElectrode(4));
+        negotiator.update(angle, electrodes_width, electrodes_height);
+        if(!webcam.read(frame)) {
+            cout << "No more frames" << endl;
+            break;
+        }
+        //Mode of this frame : a recording changes it where the camera did, without any negotiation
+        rawSize = Size(static_cast<int>(webcam.get(CAP_PROP_FRAME_WIDTH)), static_cast<int>(webcam.get(CAP_PROP_FRAME_HEIGHT)));
+        rawFourcc = static_cast<int>(webcam.get(CAP_PROP_FOURCC));
+        uint64_t const frameStart(monotonicNs());
+        recorder.record(frame, frameStart, rawSize, rawFourcc);
+        if(!rawLuma && frame.channels() != 3) {
+            //A recording of raw frames, or a backend which cannot convert them
+            cout << "Raw frames given, luma from them" << endl;
+            rawLuma = true;
+            rebuild = true;
+        }
+        if(scheduler.skipFrame()) {
+            ++skipped;
+            continue;
+        }
+        if(!rawLuma) {
+            display.show(initialWindow, frame);
+            if(mustSave) {
+                saveImage("1_initial", frame);
+            }
+        }
 
-void extendImage(Mat& img, int zoom) {
-    if(zoom <= 0) {
-        zoom = 1;
-    }
+        //With the gaze on, the crop follows the eye and the electrodes are sampled from a cached plan
+        PipelineSettings settings;
+        settings.angle = angle;
+        settings.electrodes_w = electrodes_width;
+        settings.electrodes_h = electrodes_height;
+        settings.edgeGain = edgeGain;
+        settings.rawSize = rawSize;
+        settings.rawFourcc = rawFourcc;
+        if(gazeContingent) {
+            settings.plan = &planner.plan(rawLuma ? rawSize : frame.size(), angle, electrodes_width, electrodes_height, gaze.poll());
+        }
+        temporalFilter.setAlpha(256 - smoothing * 256 / 100);
+        currentSpread.configure(spread / 10.0);
+        quantizer.configure(levels, gamma / 10.0);
+
+        if(rebuild) {
+            buildPipeline();
+            rebuild = false;
+        }
 
-    Mat finalImg(img.rows * zoom, img.cols * zoom, CV_8UC1);
+        //2 to 6, as the pipeline says
+        if(!pipeline.run(frame, settings, electrodes)) {
+            if(rawLuma) {
+                cout << "Raw frames not understood, back to BGR" << endl;
+                rawLuma = false;
+                rebuild = true;
+                webcam.set(CAP_PROP_CONVERT_RGB, 1);
+                negotiator.setUncompressed(false);
+            }
+            continue;
+        }
+        display.show(reduceWindow, kept);
+
+        //7 - Give the electrode frame to the readers, and the levels to the stimulator
+        publisher.publish(electrodes);
+        for(int y(0); y < electrodes.rows; ++y) {
+            uchar const* row(electrodes.ptr<uchar>(y));
+            for(int x(0); x < electrodes.cols * static_cast<int>(electrodes.elemSize()); ++x) {
+                checksum = (checksum ^ row[x]) * 1099511628211ull;
+            }
+        }
+        int bits(bitsPerLevel(quantizer.levels()));
+        packLevels(stimulation, bits, packed);
+        streamer.sendPacked(packed.data(), stimulation.cols, stimulation.rows, bits, stimulation.channels());
+
+        //Extend the picture because some times, it's to small.
+        //Only when the display is about to refresh, the output does not wait for it.
+        if(display.wants(modifiedWindow)) {
+            if(foveatedLayout) {
+                //The rings drawn where they are, already at the size of the crop
+                foveated.render(electrodes, layout);
+                display.show(modifiedWindow, layout);
+            } else {
+                extendImage(electrodes, zoom);
+                display.show(modifiedWindow, electrodes);
+            }
+        }
 
-    for(int y(0); y < img.rows; ++y) {
-        uchar* p = img.ptr<uchar>(y);
-        for(int x(0); x < img.cols; ++x) {
-            rectangle(finalImg, Point(x * zoom, y * zoom), Point((x + 1) * zoom, (y + 1) * zoom), Scalar(p[x]), CV_FILLED);
+        //Too slow, or room again : the pipeline changes with the level
+        uint64_t const frameNs(monotonicNs() - frameStart);
+        frameTimes.push_back(frameNs);
+        if(scheduler.endFrame(frameNs, pipeline)) {
+            rebuild = true;
         }
+        mustSave = false;
     }
 
-    img = finalImg;
-}
+    recorder.close();
+    layouts.save();
+    display.stop();
 
-void saveImage(string const& filename, Mat& img) {
-    imwrite(filename + ".jpg", img);
-    cout << "Saved as " + filename << ".jpg\n";
+    if(!frameTimes.empty()) {
+        sort(frameTimes.begin(), frameTimes.end());
+        cout << frameTimes.size() << " frames processed, " << skipped << " skipped, time (us) median " << frameTimes[frameTimes.size() / 2] / 1000
+             << " p99 " << frameTimes[frameTimes.size() * 99 / 100] / 1000 << " max " << frameTimes.back() / 1000 << endl;
+        cout << "Electrodes checksum " << hex << checksum << dec << endl;
+    }
 }
 
 void useWebcam() {
@@ -149,85 +442,99 @@ void useWebcam() {
         return;
     }
 
-    string modifiedWindow("Modified picture");
-    namedWindow(modifiedWindow, WINDOW_AUTOSIZE);
-    string initialWindow("Initial picture");
-    namedWindow(initialWindow, WINDOW_AUTOSIZE);
-    string reduceWindow("Reduced picture");
-    namedWindow(reduceWindow, WINDOW_AUTOSIZE);
-    Mat frame;
-    webcam.read(frame);
-    int height(frame.size().height);
-    int width(frame.size().width);
-    int electrodes_width(10); //Number of electrodes
-    int electrodes_height(6);
-    int angle(100); //Percentage of the width of the initial picture which will be used
-    int zoom(1); //time to extend the final picture
-
-    //Add some trackbars
-    createTrackbar("width", initialWindow, &electrodes_width, width);
-    createTrackbar("height", initialWindow, &electrodes_height, height);
-    createTrackbar("angle (%)", initialWindow, &angle, 100);
-    createTrackbar("zoom", initialWindow, &zoom, 20);
-
-    bool carryOn(true);
-    bool mustSave(false);
+    runCamera(webcam, false);
+}
 
-    while(carryOn) {
-        //Input handling
-        switch((char)waitKey(1)) {
-            case 27:
-                carryOn = false;
-                break;
+void useRecording() {
+    string filename(""), input("");
+    cout << "Recording (recording.frames) : ";
+    getline(cin, filename);
+    if(filename.empty()) {
+        filename = "recording.frames";
+    }
 
-            case 115:
-                mustSave = true;
-                break;
+    ReplayCapture replay;
+    if(!replay.open(filename)) {
+        return;
+    }
 
-            default: break;
-        }
+    //Real time for the frames the scheduler drops, as fast as possible for the throughput
+    cout << "At the camera rate (y/n) : ";
+    getline(cin, input);
+    replay.setRealTime(input.empty() || input[0] != 'n');
+    cout << "With the windows (y/n) : ";
+    getline(cin, input);
 
-        //1 - Get picture
-        webcam.read(frame);
-        imshow(initialWindow, frame);
-        if(mustSave) {
-            saveImage("1_initial", frame);
-        }
+    runCamera(replay, !input.empty() && input[0] == 'n');
+    cout << replay.missed() << " frames missed by a late reader" << endl;
+}
 
-        //2 - Convert to grayscale
-        convertImageToGrayScale(frame);
-        if(mustSave) {
-            saveImage("2_grayscale", frame);
-        }
+void useWebcams() {
+    string input("");
+    cout << "Cameras (0 1) : ";
+    getline(cin, input);
+    vector<int> devices;
+    istringstream numbers(input.empty() ? string("0 1") : input);
+    int device(0);
+    while(numbers >> device) {
+        devices.push_back(device);
+    }
 
-        //3 - Reduce to get less information
-        reduceImage(frame, angle, (double)electrodes_height / (double)electrodes_width);
-        imshow(reduceWindow, frame);
-        if(mustSave) {
-            saveImage("3_reduce", frame);
-        }
+    MultiCameraSettings settings;
+    MultiCamera cameras(settings);
+    if(cameras.open(devices) == 0) {
+        cout << "No camera could be opened" << endl;
+        return;
+    }
 
-        //4 - Reduce against in electrodes_heigth * electrodes_width
-        pixeliseImage(frame, electrodes_width, electrodes_height);
-        if(mustSave) {
-            saveImage("4_pixelise", frame);
+    //The cameras read these at every frame, the trackbars write the copies
+    string const window("cameras");
+    namedWindow(window, WINDOW_AUTOSIZE);
+    int angle(settings.angle), electrodes_width(settings.electrodes_w), electrodes_height(settings.electrodes_h), zoom(20);
+    createTrackbar("angle (%)", window, &angle, 100);
+    createTrackbar("width", window, &electrodes_width, 100);
+    createTrackbar("height", window, &electrodes_height, 100);
+    createTrackbar("zoom", window, &zoom, 40);
+
+    vector<CameraFrame> frames;
+    uint64_t skewNs(0), lastReportNs(monotonicNs());
+    Mat shown, extended;
+    while(static_cast<char>(waitKey(1)) != 27) {
+        settings.angle = angle;
+        settings.electrodes_w = electrodes_width;
+        settings.electrodes_h = electrodes_height;
+
+        if(cameras.aligned(frames, skewNs)) {
+            //Side by side, a column of 4 pixels between two cameras.
+            //The grids may differ for a frame or two after a trackbar moved.
+            int width(0), height(0);
+            int const scale(max(zoom, 1));
+            for(CameraFrame const& frame : frames) {
+                width += frame.electrodes.cols * scale + 4;
+                height = max(height, frame.electrodes.rows * scale);
+            }
+            shown.create(max(height, 1), max(width - 4, 1), CV_8UC1);
+            shown.setTo(Scalar(0));
+            int x(0);
+            for(CameraFrame& frame : frames) {
+                if(!frame.electrodes.empty()) {
+                    frame.electrodes.copyTo(extended);
+                    extendImage(extended, scale);
+                    extended.copyTo(shown(Rect(x, 0, extended.cols, extended.rows)));
+                }
+                x += frame.electrodes.cols * scale + 4;
+            }
+            imshow(window, shown);
         }
 
-        //5 - Reverse the picture
-        reverseImage(frame);
-        if(mustSave) {
-            saveImage("5_reverse", frame);
+        if(monotonicNs() - lastReportNs >= 2000000000ull) {
+            cameras.report();
+            lastReportNs = monotonicNs();
         }
-
-        //Extend the picture because some times, it's to small
-        extendImage(frame, zoom);
-
-        //Show image
-        imshow(modifiedWindow, frame);
-        mustSave = false;
     }
 
-    destroyAllWindows();
+    cameras.close();
+    destroyWindow(window);
 }
 
 void useFile() {
@@ -244,6 +551,21 @@ void useFile() {
 
     cout << "Load successful !\n\n";
 
+    //Every step is shown, so none of them may be fused or moved.
+    //The grayscale picture is made once, the next steps run on the level of its pyramid the grid needs,
+    //so moving a trackbar does not go through all the pixels of a big photo again.
+    Pipeline grayscale;
+    grayscale.add(new GrayStage(false));
+    Pipeline pipeline(FRAME_GRAY);
+    pipeline.add(new ReduceStage(false));
+    pipeline.add(new PixeliseStage(false));
+    pipeline.add(new ReverseStage);
+    pipeline.add(new ExtendStage);
+    pipeline.watchAll();
+    PipelineSettings settings;
+    ImagePyramid pyramid;
+    Mat step;
+
     //Display initial picture
     namedWindow("initial picture", WINDOW_AUTOSIZE);
     imshow("initial picture", img);
@@ -252,65 +574,102 @@ void useFile() {
 
     //Display grayscale picture
     namedWindow("grayscale picture", WINDOW_AUTOSIZE);
-    convertImageToGrayScale(img);
-    imshow("grayscale picture", img);
+    grayscale.run(img, settings, step);
+    Mat baseImg(step.clone());
+    pyramid.reset(baseImg);
+    imshow("grayscale picture", baseImg);
     waitKey(0); //Wait before next step
     destroyWindow("grayscale picture");
-    saveImage("1_grayscale", img);
+    saveImage("1_grayscale", baseImg);
 
     //Display reduce picture
     string window("before reduce picture"), window2("after reduce picture");
     namedWindow(window, WINDOW_AUTOSIZE);
-    int angle(100),
-        electrodes_width(10), electrodes_height(6),
-        width(img.size().width), height(img.size().height);
-    Mat baseImg;
-    img.copyTo(baseImg);
-    createTrackbar("angle (%)", window, &angle, 100);
-    createTrackbar("width", window, &electrodes_width, width);
-    createTrackbar("height", window, &electrodes_height, height);
+    int width(img.size().width), height(img.size().height);
+    createTrackbar("angle (%)", window, &settings.angle, 100);
+    createTrackbar("width", window, &settings.electrodes_w, width);
+    createTrackbar("height", window, &settings.electrodes_h, height);
     while(static_cast<char>(waitKey(1)) != 13) {
-        baseImg.copyTo(img);
-
-        reduceImage(img, angle, (double)electrodes_height / (double)electrodes_width);
+        pipeline.run(pyramid.forGrid(settings.angle, settings.electrodes_w, settings.electrodes_h), settings, step, 1);
 
         imshow(window, baseImg);
-        imshow(window2, img);
+        imshow(window2, step);
     }
     destroyWindow(window);
     destroyWindow(window2);
-    saveImage("2_reduce", img);
+    saveImage("2_reduce", step);
 
     //Display pixelise picture
     window = "before pixelise picture";
     window2 = "after pixelise picture";
     namedWindow(window, WINDOW_AUTOSIZE);
     Mat zoomImg;
-    img.copyTo(baseImg);
-    int zoom(1);
-    createTrackbar("zoom", window, &zoom, 20);
+    baseImg = step.clone(); //Not copied into baseImg : the pyramid may share its pixels
+    createTrackbar("zoom", window, &settings.zoom, 20);
     while(static_cast<char>(waitKey(1)) != 13) {
-        baseImg.copyTo(img);
-
-        pixeliseImage(img, electrodes_width, electrodes_height);
+        pipeline.run(pyramid.forGrid(settings.angle, settings.electrodes_w, settings.electrodes_h), settings, step, 2);
 
-        img.copyTo(zoomImg);
-        extendImage(zoomImg, zoom);
+        step.copyTo(zoomImg);
+        extendImage(zoomImg, settings.zoom);
 
         imshow(window, baseImg);
         imshow(window2, zoomImg);
     }
     destroyWindow(window);
     destroyWindow(window2);
-    saveImage("3_pixelise", img);
+    saveImage("3_pixelise", step);
+
+    //Display reverse picture
+    namedWindow("reverse picture", WINDOW_AUTOSIZE);
+    Mat const& level(pyramid.forGrid(settings.angle, settings.electrodes_w, settings.electrodes_h));
+    pipeline.run(level, settings, step, 3);
+    saveImage("4_reverse", step);
+    pipeline.run(level, settings, step);
+    imshow("reverse picture", step);
+    waitKey(0); //Wait before next step
+    destroyWindow("reverse picture");
+}
+
+void useBigFile() {
+    string filename(""), input("");
+    cout << "Filename : ";
+    getline(cin, filename);
+
+    //No trackbars here : the picture is never in memory to be shown
+    int electrodes_width(10), electrodes_height(6), angle(100);
+    cout << "Electrodes width (10) : ";
+    getline(cin, input);
+    if(!input.empty()) {
+        electrodes_width = atoi(input.c_str());
+    }
+    cout << "Electrodes height (6) : ";
+    getline(cin, input);
+    if(!input.empty()) {
+        electrodes_height = atoi(input.c_str());
+    }
+    cout << "Angle (100 %) : ";
+    getline(cin, input);
+    if(!input.empty()) {
+        angle = atoi(input.c_str());
+    }
+    //Same ranges as the trackbars
+    electrodes_width = max(electrodes_width, 1);
+    electrodes_height = max(electrodes_height, 1);
+    angle = min(max(angle, 0), 100);
+
+    Mat img;
+    if(!reduceImageFile(filename, angle, electrodes_width, electrodes_height, img)) {
+        return;
+    }
+    saveImage("1_pixelise", img);
 
     //Display reverse picture
     namedWindow("reverse picture", WINDOW_AUTOSIZE);
     reverseImage(img);
-    saveImage("4_reverse", img);
-    extendImage(img, zoom);
+    saveImage("2_reverse", img);
+    extendImage(img, max(1, 600 / max(img.cols, 1)));
     imshow("reverse picture", img);
-    waitKey(0); //Wait before next step
+    waitKey(0);
     destroyWindow("reverse picture");
 }
 
@@ -320,8 +679,12 @@ int main() {
         cout << "What do you want to use ?\n";
         cout << "1 - your webcam\n";
         cout << "2 - a local picture\n";
-        cout << "3 - quit\n\n";
-        cout << "Enter 1 or 2 or 3 and then press enter\n\n";
+        cout << "3 - quit\n";
+        cout << "4 - check the kernels\n";
+        cout << "5 - a picture too big for the memory\n";
+        cout << "6 - several webcams\n";
+        cout << "7 - a recording of your webcam ('c' to record)\n\n";
+        cout << "Enter 1 or 2 or 3 or 4 or 5 or 6 or 7 and then press enter\n\n";
         string input("");
         getline(cin, input);
 
@@ -332,6 +695,16 @@ int main() {
                 useFile();
             } else if(input[0] == '3') {
                 quit = true;
+            } else if(input[0] == '4') {
+                checkFixedPointPipeline(1000);
+                checkKernelVariants(1000);
+                checkContrastWithDefects();
+            } else if(input[0] == '5') {
+                useBigFile();
+            } else if(input[0] == '6') {
+                useWebcams();
+            } else if(input[0] == '7') {
+                useRecording();
             }
         }
         cout << "\n\n";
@@ -0,0 +1,252 @@
+#include "multicam.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "captureconfig.h"
+#include "pipeline.h"
+#include "stages.h"
+#include "timing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+//Pins the calling thread, so that two cameras never fight for the same core
+bool pinToCore(int core) {
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core) != 0;
+#elif defined(__linux__)
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+}
+
+CameraWorker::CameraWorker(int device, int core, MultiCameraSettings const& settings)
+    : m_device(device), m_core(core), m_settings(settings), m_running(false), m_frames(0), m_countedFrames(0), m_countedNs(monotonicNs()) {
+}
+
+CameraWorker::~CameraWorker() {
+    stop();
+}
+
+bool CameraWorker::start() {
+    if(m_running) {
+        return true;
+    }
+
+    //Opened here rather than in the thread, to know at once whether the camera is there
+    if(!m_camera.open(m_device)) {
+        cout << "Camera " << m_device << " : can not be opened" << endl;
+        return false;
+    }
+
+    m_running = true;
+    m_thread = thread(&CameraWorker::run, this);
+    return true;
+}
+
+void CameraWorker::stop() {
+    if(!m_running) {
+        return;
+    }
+
+    m_running = false;
+    m_thread.join();
+    m_camera.release();
+}
+
+void CameraWorker::run() {
+    if(m_core >= 0) {
+        if(pinToCore(m_core)) {
+            cout << "Camera " << m_device << " : on core " << m_core << endl;
+        } else {
+            cout << "Camera " << m_device << " : could not be pinned to core " << m_core << endl;
+        }
+    }
+
+    //Its own pipeline and its own buffers : nothing is shared with the other cameras
+    Pipeline pipeline;
+    pipeline.add(new GrayStage(true));
+    pipeline.add(new ReduceStage(true));
+    pipeline.add(new PixeliseStage(true));
+    pipeline.add(new ReverseStage());
+    if(!pipeline.compile()) {
+        return;
+    }
+
+    CaptureNegotiator negotiator(m_camera);
+    PipelineSettings settings;
+    Mat frame, electrodes;
+    while(m_running) {
+        settings.angle = max(m_settings.angle.load(), 1);
+        settings.electrodes_w = max(m_settings.electrodes_w.load(), 1);
+        settings.electrodes_h = max(m_settings.electrodes_h.load(), 1);
+        negotiator.update(settings.angle, settings.electrodes_w, settings.electrodes_h);
+
+        if(!m_camera.read(frame) || frame.empty()) {
+            //A camera which stops giving pictures only goes stale, the others carry on
+            this_thread::sleep_for(chrono::milliseconds(10));
+            continue;
+        }
+        //read() returns when the picture is there : the best time of the capture the camera gives
+        uint64_t const timestamp(monotonicNs());
+
+        if(!pipeline.run(frame, settings, electrodes)) {
+            continue;
+        }
+
+        lock_guard<mutex> lock(m_mutex);
+        CameraFrame& slot(m_history[m_frames % historySize]);
+        electrodes.copyTo(slot.electrodes);
+        slot.timestampNs = timestamp;
+        slot.number = m_frames;
+        ++m_frames;
+    }
+}
+
+bool CameraWorker::frameAt(uint64_t timestampNs, CameraFrame& frame) const {
+    lock_guard<mutex> lock(m_mutex);
+    if(m_frames == 0) {
+        return false;
+    }
+
+    unsigned int const available(min<unsigned int>(m_frames, historySize));
+    CameraFrame const* best(&m_history[(m_frames - 1) % historySize]);
+    if(timestampNs != 0) {
+        uint64_t bestDistance(numeric_limits<uint64_t>::max());
+        for(unsigned int i(0); i < available; ++i) {
+            CameraFrame const& candidate(m_history[(m_frames - 1 - i) % historySize]);
+            uint64_t const distance(candidate.timestampNs > timestampNs ? candidate.timestampNs - timestampNs : timestampNs - candidate.timestampNs);
+            if(distance < bestDistance) {
+                bestDistance = distance;
+                best = &candidate;
+            }
+        }
+    }
+
+    //A copy : the slot is written again by the camera thread historySize frames later
+    best->electrodes.copyTo(frame.electrodes);
+    frame.timestampNs = best->timestampNs;
+    frame.number = best->number;
+    return true;
+}
+
+uint64_t CameraWorker::latestNs() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_frames == 0 ? 0 : m_history[(m_frames - 1) % historySize].timestampNs;
+}
+
+double CameraWorker::throughput() {
+    unsigned int frames;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        frames = m_frames;
+    }
+
+    uint64_t const now(monotonicNs());
+    double const fps(now > m_countedNs ? (frames - m_countedFrames) * 1e9 / (now - m_countedNs) : 0);
+    m_countedFrames = frames;
+    m_countedNs = now;
+    return fps;
+}
+
+MultiCamera::MultiCamera(MultiCameraSettings const& settings) : m_settings(settings), m_skewTotalNs(0), m_skewMaxNs(0), m_alignments(0) {
+}
+
+MultiCamera::~MultiCamera() {
+    close();
+}
+
+size_t MultiCamera::open(vector<int> const& devices) {
+    close();
+
+    int const cores(max<int>(thread::hardware_concurrency(), 1));
+    for(size_t i(0); i < devices.size(); ++i) {
+        //Not pinned when there are not enough cores for one each
+        int const core(static_cast<int>(i) + 1 < cores ? static_cast<int>(i) + 1 : -1);
+        unique_ptr<CameraWorker> worker(new CameraWorker(devices[i], core, m_settings));
+        if(worker->start()) {
+            m_workers.push_back(move(worker));
+        }
+    }
+    return m_workers.size();
+}
+
+void MultiCamera::close() {
+    for(unique_ptr<CameraWorker>& worker : m_workers) {
+        worker->stop();
+    }
+    m_workers.clear();
+}
+
+bool MultiCamera::aligned(vector<CameraFrame>& frames, uint64_t& skewNs, double staleMs) {
+    vector<uint64_t> latest(m_workers.size());
+    uint64_t newest(0);
+    for(size_t i(0); i < m_workers.size(); ++i) {
+        latest[i] = m_workers[i]->latestNs();
+        newest = max(newest, latest[i]);
+    }
+    if(newest == 0) {
+        return false;
+    }
+
+    //The slowest camera still giving pictures sets the time, a frozen one is not waited for
+    uint64_t const stale(static_cast<uint64_t>(staleMs * 1e6));
+    vector<bool> live(m_workers.size());
+    uint64_t reference(newest);
+    for(size_t i(0); i < m_workers.size(); ++i) {
+        live[i] = latest[i] != 0 && newest - latest[i] <= stale;
+        if(live[i]) {
+            reference = min(reference, latest[i]);
+        }
+    }
+
+    frames.resize(m_workers.size());
+    uint64_t first(numeric_limits<uint64_t>::max()), last(0);
+    for(size_t i(0); i < m_workers.size(); ++i) {
+        if(!m_workers[i]->frameAt(live[i] ? reference : 0, frames[i])) {
+            frames[i] = CameraFrame();
+        } else if(live[i]) {
+            first = min(first, frames[i].timestampNs);
+            last = max(last, frames[i].timestampNs);
+        }
+    }
+
+    skewNs = last - first;
+    m_skewTotalNs += skewNs;
+    m_skewMaxNs = max(m_skewMaxNs, skewNs);
+    ++m_alignments;
+    return true;
+}
+
+void MultiCamera::report() {
+    for(unique_ptr<CameraWorker>& worker : m_workers) {
+        cout << "Camera " << worker->device() << " : " << worker->throughput() << " fps, ";
+    }
+    if(m_alignments > 0) {
+        cout << "skew " << m_skewTotalNs / 1e6 / m_alignments << " ms on average, " << m_skewMaxNs / 1e6 << " ms at most" << endl;
+    } else {
+        cout << "no frame yet" << endl;
+    }
+    m_skewTotalNs = 0;
+    m_skewMaxNs = 0;
+    m_alignments = 0;
+}
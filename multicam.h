@@ -0,0 +1,104 @@
+#ifndef MULTICAM_H_INCLUDED
+#define MULTICAM_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+//Several cameras at once (two for a bilateral implant) : every camera has its own thread,
+//pinned to its own core, with its own capture and pipeline. The threads never wait for each other,
+//the output only pairs the frames whose timestamps are the closest.
+
+struct CameraFrame {
+    cv::Mat electrodes;
+    uint64_t timestampNs; //monotonicNs() when the picture was read, 0 for no frame yet
+    unsigned int number;
+
+    CameraFrame() : timestampNs(0), number(0) {}
+};
+
+//What the user sets, read by every camera at each frame
+struct MultiCameraSettings {
+    std::atomic<int> angle;
+    std::atomic<int> electrodes_w;
+    std::atomic<int> electrodes_h;
+
+    MultiCameraSettings() : angle(100), electrodes_w(10), electrodes_h(6) {}
+};
+
+class CameraWorker {
+public:
+    //'core' < 0 : the thread is not pinned
+    CameraWorker(int device, int core, MultiCameraSettings const& settings);
+    ~CameraWorker();
+
+    bool start();
+    void stop();
+
+    int device() const { return m_device; }
+
+    //The frame of the history taken the closest to 'timestampNs', or the latest one for 0.
+    //False if the camera has not given any frame yet.
+    bool frameAt(uint64_t timestampNs, CameraFrame& frame) const;
+    uint64_t latestNs() const;
+
+    //Frames processed per second since the last call
+    double throughput();
+
+private:
+    void run();
+
+    static int const historySize = 8;
+
+    int m_device;
+    int m_core;
+    MultiCameraSettings const& m_settings;
+
+    cv::VideoCapture m_camera; //Only read by the thread once started
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+
+    mutable std::mutex m_mutex; //Held only to copy a frame in or out of the history
+    CameraFrame m_history[historySize];
+    unsigned int m_frames;
+
+    unsigned int m_countedFrames;
+    uint64_t m_countedNs;
+};
+
+class MultiCamera {
+public:
+    explicit MultiCamera(MultiCameraSettings const& settings);
+    ~MultiCamera();
+
+    //One core per camera, from the second one : the first is left to the display.
+    //Returns the number of cameras which opened.
+    size_t open(std::vector<int> const& devices);
+    void close();
+
+    size_t size() const { return m_workers.size(); }
+
+    //One frame per camera, the latest of the slowest one and the closest to it of the others,
+    //so the frames were taken at the same time as much as the cameras allow.
+    //A camera whose latest frame is older than 'staleMs' is left out of the alignment (and not waited for),
+    //its latest frame is given. 'skewNs' is the spread of the timestamps of the aligned frames.
+    bool aligned(std::vector<CameraFrame>& frames, uint64_t& skewNs, double staleMs = 200);
+
+    //Throughput of every camera and skew of the aligned frames since the last report
+    void report();
+
+private:
+    MultiCameraSettings const& m_settings;
+    std::vector<std::unique_ptr<CameraWorker> > m_workers;
+
+    uint64_t m_skewTotalNs, m_skewMaxNs;
+    unsigned int m_alignments;
+};
+
+#endif // MULTICAM_H_INCLUDED
@@ -0,0 +1,243 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include "timing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+char const* kindName(FrameKind kind) {
+    switch(kind) {
+        case FRAME_BGR: return "BGR";
+        case FRAME_RAW: return "raw";
+        case FRAME_GRAY: return "gray";
+        case FRAME_ELECTRODES: return "electrodes";
+        case FRAME_BGR_ELECTRODES: return "BGR electrodes";
+    }
+    return "?";
+}
+
+}
+
+PipelineSettings::PipelineSettings()
+    : angle(100), electrodes_w(10), electrodes_h(6), zoom(1), edgeGain(2), plan(nullptr), rawFourcc(0) {
+}
+
+Pipeline::Pipeline(FrameKind input) : m_input(input), m_watchAll(false), m_compiled(false) {
+}
+
+void Pipeline::add(Stage* stage) {
+    m_stages.push_back(unique_ptr<Stage>(stage));
+    m_compiled = false;
+}
+
+void Pipeline::clear(FrameKind input) {
+    m_input = input;
+    m_stages.clear();
+    m_compiled = false;
+}
+
+void Pipeline::watch(string const& stage) {
+    m_watched.push_back(stage);
+    m_compiled = false;
+}
+
+void Pipeline::watchAll() {
+    m_watchAll = true;
+    m_compiled = false;
+}
+
+void Pipeline::setObserver(function<void(size_t, Stage const&, Mat const&)> const& observer) {
+    m_observer = observer;
+}
+
+bool Pipeline::watched(Stage const& stage) const {
+    return m_watchAll || find(m_watched.begin(), m_watched.end(), stage.name()) != m_watched.end();
+}
+
+bool Pipeline::fuse() {
+    FrameKind kind(m_input);
+    for(size_t i(0); i + 1 < m_stages.size(); ++i) {
+        Stage& stage(*m_stages[i]);
+        Stage& next(*m_stages[i + 1]);
+
+        if(!watched(stage) && stage.accepts(kind)) {
+            //Pixel by pixel then crop : crop first, the rest of the picture is never converted
+            if(stage.perPixel() && next.isCrop() && next.accepts(kind) && stage.accepts(next.output(kind))) {
+                m_fusions.push_back(stage.name() + " moved after " + next.name());
+                swap(m_stages[i], m_stages[i + 1]);
+                return true;
+            }
+
+            //The next stage converts to gray the same way on its own, row by row
+            if(stage.fixedLuma() && next.accepts(kind) && next.output(kind) == next.output(stage.output(kind))) {
+                m_fusions.push_back(stage.name() + " done by " + next.name());
+                m_stages.erase(m_stages.begin() + i);
+                return true;
+            }
+        }
+
+        if(!stage.accepts(kind)) {
+            return false;
+        }
+        kind = stage.output(kind);
+    }
+    return false;
+}
+
+bool Pipeline::compile() {
+    m_compiled = false;
+    m_fusions.clear();
+    while(fuse()) {
+    }
+
+    m_kinds.clear();
+    FrameKind kind(m_input);
+    for(unique_ptr<Stage> const& stage : m_stages) {
+        if(!stage->accepts(kind)) {
+            cout << "Pipeline : " << stage->name() << " does not take " << kindName(kind) << " pictures" << endl;
+            return false;
+        }
+        kind = stage->output(kind);
+        m_kinds.push_back(kind);
+    }
+
+    //A buffer is reused by a later stage giving the same kind of picture,
+    //unless it holds the input of that stage (directly or through views and in place stages)
+    m_buffer.assign(m_stages.size(), -1);
+    vector<FrameKind> bufferKinds;
+    int owner(-1); //Buffer holding the current picture, -1 for the input of the pipeline
+    for(size_t i(0); i < m_stages.size(); ++i) {
+        if(m_stages[i]->memory() != STAGE_BUFFER) {
+            continue;
+        }
+
+        int chosen(-1);
+        for(size_t b(0); b < bufferKinds.size() && chosen < 0; ++b) {
+            if(bufferKinds[b] == m_kinds[i] && static_cast<int>(b) != owner) {
+                chosen = static_cast<int>(b);
+            }
+        }
+        if(chosen < 0) {
+            chosen = static_cast<int>(bufferKinds.size());
+            bufferKinds.push_back(m_kinds[i]);
+        }
+        m_buffer[i] = chosen;
+        owner = chosen;
+    }
+    m_buffers.resize(bufferKinds.size());
+    m_costs.assign(m_stages.size(), 0);
+
+    m_compiled = true;
+    return true;
+}
+
+bool Pipeline::run(Mat const& input, PipelineSettings const& settings, Mat& output, size_t stages) {
+    return runStages(input, settings, output, stages, false);
+}
+
+bool Pipeline::runInto(Mat const& input, PipelineSettings const& settings, Mat& output) {
+    return runStages(input, settings, output, static_cast<size_t>(-1), true);
+}
+
+bool Pipeline::runStages(Mat const& input, PipelineSettings const& settings, Mat& output, size_t stages, bool into) {
+    if(!m_compiled && !compile()) {
+        return false;
+    }
+
+    Mat value(input);
+    stages = min(stages, m_stages.size());
+    for(size_t i(0); i < stages; ++i) {
+        Stage& stage(*m_stages[i]);
+        Mat out;
+        bool done(false);
+        uint64_t const start(monotonicNs());
+
+        switch(stage.memory()) {
+            case STAGE_VIEW:
+                done = stage.run(value, out, settings);
+                break;
+
+            case STAGE_IN_PLACE:
+                out = value;
+                done = stage.run(out, out, settings);
+                break;
+
+            case STAGE_BUFFER: {
+                //The stage writes in the buffer when it has the right size already
+                bool const caller(into && i + 1 == stages);
+                out = caller ? output : m_buffers[m_buffer[i]];
+                done = stage.run(value, out, settings);
+                //A stage which gave back (part of) its input does not own the buffer,
+                //and the memory of the caller is not kept for the next frame
+                if(!caller && out.u != value.u) {
+                    m_buffers[m_buffer[i]] = out;
+                }
+                break;
+            }
+        }
+
+        if(!done) {
+            return false;
+        }
+
+        //1/8 of the new measure, enough to follow a change in a few frames without jumping at every hiccup
+        double const cost(static_cast<double>(monotonicNs() - start));
+        m_costs[i] = m_costs[i] == 0 ? cost : m_costs[i] + (cost - m_costs[i]) / 8;
+
+        if(m_observer) {
+            m_observer(i + 1, stage, out);
+        }
+        value = out;
+    }
+
+    output = value;
+    return true;
+}
+
+double Pipeline::costMs() const {
+    double total(0);
+    for(double cost : m_costs) {
+        total += cost;
+    }
+    return total / 1e6;
+}
+
+size_t Pipeline::costliestStage() const {
+    size_t costliest(0);
+    for(size_t i(1); i < m_costs.size(); ++i) {
+        if(m_costs[i] > m_costs[costliest]) {
+            costliest = i;
+        }
+    }
+    return costliest;
+}
+
+string Pipeline::describe() const {
+    ostringstream description;
+    FrameKind kind(m_input);
+    for(size_t i(0); i < m_stages.size(); ++i) {
+        Stage const& stage(*m_stages[i]);
+        description << i + 1 << " - " << stage.name() << " : " << kindName(kind) << " -> ";
+        kind = stage.output(kind);
+        description << kindName(kind);
+
+        if(stage.memory() == STAGE_VIEW) {
+            description << ", view";
+        } else if(stage.memory() == STAGE_IN_PLACE) {
+            description << ", in place";
+        } else if(i < m_buffer.size()) {
+            description << ", buffer " << m_buffer[i];
+        }
+        description << "\n";
+    }
+    for(string const& fusion : m_fusions) {
+        description << "(" << fusion << ")\n";
+    }
+    return description.str();
+}
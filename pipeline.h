@@ -0,0 +1,128 @@
+#ifndef PIPELINE_H_INCLUDED
+#define PIPELINE_H_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct SamplingPlan;
+
+//What goes from one stage to the next
+enum FrameKind {
+    FRAME_BGR,           //Camera or file picture
+    FRAME_RAW,           //Camera buffer as the driver gives it (CAP_PROP_CONVERT_RGB off)
+    FRAME_GRAY,          //Grayscale picture
+    FRAME_ELECTRODES,    //One value per electrode
+    FRAME_BGR_ELECTRODES //One BGR value per electrode, for the arrays with a channel per colour
+};
+
+//How a stage gets its output
+enum StageMemory {
+    STAGE_VIEW,     //Part of its input, nothing is copied
+    STAGE_IN_PLACE, //Written over its input
+    STAGE_BUFFER    //In a buffer of the pipeline, kept from one frame to the next
+};
+
+//What the stages read on every frame, changed by the trackbars
+struct PipelineSettings {
+    PipelineSettings();
+
+    int angle;
+    int electrodes_w, electrodes_h;
+    int zoom;
+    int edgeGain;
+    SamplingPlan const* plan; //Crop and electrodes following the gaze, null for the centred crop
+    cv::Size rawSize;         //Size and format of the FRAME_RAW pictures
+    int rawFourcc;
+};
+
+class Stage {
+public:
+    virtual ~Stage() {}
+
+    virtual std::string name() const = 0;
+    virtual bool accepts(FrameKind input) const = 0;
+    virtual FrameKind output(FrameKind input) const = 0;
+    virtual StageMemory memory() const { return STAGE_BUFFER; }
+
+    //For the fusions : a stage which works pixel by pixel can be moved after a crop,
+    //and a stage doing the same grayscale conversion as convertImageToGrayScaleFixed() can be left to the next
+    //stage if this one takes BGR too.
+    virtual bool perPixel() const { return false; }
+    virtual bool isCrop() const { return false; }
+    virtual bool fixedLuma() const { return false; }
+
+    //STAGE_IN_PLACE : 'in' and 'out' are the same picture.
+    //Returns false if the frame cannot be processed, the next stages are skipped then.
+    virtual bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings) = 0;
+};
+
+//Stages run one after the other. compile() checks that every stage accepts what the previous one gives,
+//merges the stages which can be, and chooses where every output goes once for all :
+//the views and the in place stages copy nothing, and the buffers are reused frame after frame,
+//by all the stages giving the same kind of picture when their content is not needed anymore.
+class Pipeline {
+public:
+    explicit Pipeline(FrameKind input = FRAME_BGR);
+
+    //The pipeline owns the stage
+    void add(Stage* stage);
+    void clear(FrameKind input);
+
+    //A watched stage is never fused away nor moved : its output stays what it would be without fusion
+    void watch(std::string const& stage);
+    void watchAll();
+
+    //Called after every stage, with its position (from 1) and its output
+    void setObserver(std::function<void(size_t, Stage const&, cv::Mat const&)> const& observer);
+
+    bool compile();
+    bool compiled() const { return m_compiled; }
+
+    //Run the first 'stages' stages (all by default). 'output' shares the buffer of the last one.
+    bool run(cv::Mat const& input, PipelineSettings const& settings, cv::Mat& output, size_t stages = static_cast<size_t>(-1));
+
+    //Run all the stages, the last one writing straight into 'output' (memory of the caller) when it
+    //fills a buffer of the same size and type. 'output' must not overlap the input.
+    bool runInto(cv::Mat const& input, PipelineSettings const& settings, cv::Mat& output);
+
+    size_t size() const { return m_stages.size(); }
+    Stage const& stage(size_t i) const { return *m_stages[i]; }
+    //What stage i takes, once compiled
+    FrameKind stageInput(size_t i) const { return i == 0 ? m_input : m_kinds[i - 1]; }
+
+    //Measured time of every stage, smoothed over the last frames (0 until it ran)
+    double stageCostMs(size_t i) const { return m_costs[i] / 1e6; }
+    double costMs() const;
+    size_t costliestStage() const;
+
+    //One line per stage, with where its output goes
+    std::string describe() const;
+
+private:
+    Pipeline(Pipeline const&);
+    Pipeline& operator=(Pipeline const&);
+
+    bool watched(Stage const& stage) const;
+    bool fuse();
+    bool runStages(cv::Mat const& input, PipelineSettings const& settings, cv::Mat& output, size_t stages, bool into);
+
+    FrameKind m_input;
+    std::vector<std::unique_ptr<Stage> > m_stages;
+    std::vector<std::string> m_watched;
+    bool m_watchAll;
+    std::function<void(size_t, Stage const&, cv::Mat const&)> m_observer;
+
+    bool m_compiled;
+    std::vector<FrameKind> m_kinds; //Output of every stage
+    std::vector<int> m_buffer;      //Buffer of every stage, -1 for the views and the in place stages
+    std::vector<cv::Mat> m_buffers;
+    std::vector<double> m_costs; //ns
+    std::vector<std::string> m_fusions;
+};
+
+#endif // PIPELINE_H_INCLUDED
@@ -0,0 +1,52 @@
+#include "pixelisekernels.h"
+
+using namespace cv;
+
+namespace {
+
+typedef void (*PixeliseKernel)(Mat const&, Mat&);
+
+struct KnownGrid {
+    int width, height;
+    PixeliseKernel kernel;
+};
+
+//The grids of the implants we simulate
+KnownGrid const knownGrids[] = {
+    {10, 6, &pixelise<10, 6>},
+    {16, 16, &pixelise<16, 16>},
+    {32, 32, &pixelise<32, 32>},
+    {100, 60, &pixelise<100, 60>}
+};
+
+PixeliseKernel findKernel(int electrodes_w, int electrodes_h) {
+    for(KnownGrid const& grid : knownGrids) {
+        if(grid.width == electrodes_w && grid.height == electrodes_h) {
+            return grid.kernel;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+void pixeliseImageDispatch(Mat const& img, int electrodes_w, int electrodes_h, Mat& electrodes) {
+    PixeliseKernel kernel(findKernel(electrodes_w, electrodes_h));
+    if(kernel != nullptr) {
+        kernel(img, electrodes);
+    } else {
+        pixeliseImage(img, electrodes_w, electrodes_h, electrodes);
+    }
+}
+
+void pixeliseImageDispatch(Mat& img, int electrodes_w, int electrodes_h) {
+    Mat electrodes;
+    pixeliseImageDispatch(img, electrodes_w, electrodes_h, electrodes);
+    if(!electrodes.empty()) {
+        img = electrodes;
+    }
+}
+
+bool hasPixeliseKernel(int electrodes_w, int electrodes_h) {
+    return findKernel(electrodes_w, electrodes_h) != nullptr;
+}
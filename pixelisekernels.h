@@ -0,0 +1,66 @@
+#ifndef PIXELISEKERNELS_H_INCLUDED
+#define PIXELISEKERNELS_H_INCLUDED
+
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "fixedpoint.h"
+#include "processing.h"
+
+//pixeliseImage() for the grids of our implants, known at compile time.
+//The number of blocks is a constant, so the compiler sees the whole loop nest and unrolls it.
+//The size of a block still depends on the camera : its divisor is computed once per frame.
+template<int W, int H>
+void pixelise(cv::Mat const& img, cv::Mat& electrodes) {
+    static_assert(W > 0 && H > 0, "The grid needs at least one electrode");
+    static const int ELECTRODES = W * H;
+    static_assert(ELECTRODES <= 0xFFFF, "Grid too big for a specialised kernel");
+
+    //Smaller than the grid : pixeliseImage() clamps the grid, so it is not this one anymore
+    if(img.channels() != 1 || img.cols < W || img.rows < H) {
+        pixeliseImage(img, W, H, electrodes);
+        return;
+    }
+
+    int const blockW(img.cols / W),
+              blockH(img.rows / H);
+    BlockDivisor const divisor(blockW * blockH);
+    electrodes.create(H, W, CV_8UC1);
+
+    for(int by(0); by < H; ++by) {
+        uint32_t sums[W] = {};
+
+        for(int y(by * blockH); y < (by + 1) * blockH; ++y) {
+            uchar const* p(img.ptr<uchar>(y));
+            for(int bx(0); bx < W; ++bx, p += blockW) {
+                //4 accumulators, so the additions do not wait for each other
+                uint32_t a(0), b(0), c(0), d(0);
+                int x(0);
+                for(; x + 4 <= blockW; x += 4) {
+                    a += p[x];
+                    b += p[x + 1];
+                    c += p[x + 2];
+                    d += p[x + 3];
+                }
+                for(; x < blockW; ++x) {
+                    a += p[x];
+                }
+                sums[bx] += a + b + c + d;
+            }
+        }
+
+        uchar* out(electrodes.ptr<uchar>(by));
+        for(int bx(0); bx < W; ++bx) {
+            out[bx] = divisor.divide(sums[bx]);
+        }
+    }
+}
+
+//Use the specialised kernel when electrodes_w x electrodes_h is one of our grids (10x6, 16x16, 32x32, 100x60),
+//pixeliseImage() otherwise. Same result in both cases.
+void pixeliseImageDispatch(cv::Mat& img, int electrodes_w, int electrodes_h);
+void pixeliseImageDispatch(cv::Mat const& img, int electrodes_w, int electrodes_h, cv::Mat& electrodes);
+bool hasPixeliseKernel(int electrodes_w, int electrodes_h);
+
+#endif // PIXELISEKERNELS_H_INCLUDED
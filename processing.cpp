@@ -0,0 +1,171 @@
+#include "processing.h"
+
+#include <cmath>
+#include <iostream>
+
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+bool loadImage(Mat& img, string filename) {
+    img = imread(filename.c_str(), IMREAD_COLOR);
+
+    if(img.empty()) {
+        cout << "Could not open or find image : " << filename << endl;
+        return false;
+    } else {
+        cout << "Opened : " << filename << endl;
+        return true;
+    }
+}
+
+void convertImageToGrayScale(Mat& img) {
+    cvtColor(img, img, COLOR_BGR2GRAY);
+}
+
+Rect reduceRect(int cols, int rows, int angle, double scale) {
+    //No electrode in a row : the ratio is infinite, or not a number
+    if(!isfinite(scale)) {
+        return Rect(0, 0, cols, rows);
+    }
+
+    //The ratio of the electrodes is not exact in a double, 1200 * 0.82 would give 983.99... and one row less
+    int w(cols * angle / 100),
+        h(w * scale + 1e-6),
+        x((cols - w) / 2),
+        y((rows - h) / 2);
+
+    //Avoid matrix of 0 x i
+    if(w == 0 || h == 0) {
+        return Rect(0, 0, cols, rows);
+    }
+
+    if(w + x > cols) {
+        return Rect(0, y, cols, h);
+    } else if(h + y> rows) {
+        return Rect(x, 0, w, rows);
+    }
+    return Rect(x, y, w, h);
+}
+
+void reduceImage(Mat& img, int angle, double scale) {
+    img = Mat(img, reduceRect(img.cols, img.rows, angle, scale));
+}
+
+//No more imagination, sorry
+//Need the picture in gray scale, or in BGR for one average per channel
+void pixeliseImage(Mat const& img, int electrodes_w, int electrodes_h, Mat& electrodes) {
+    //To avoid errors
+    int const channels(img.channels());
+    if(channels != 1 && channels != 3) {
+        cout << "Too more channels. Channel expected 1 or 3." << endl;
+        return;
+    }
+
+    if(electrodes_w == 0) {
+        electrodes_w = 1;
+    } else if(electrodes_w > img.cols) {
+        electrodes_w = img.cols;
+    }
+    if(electrodes_h == 0) {
+        electrodes_h = 1;
+    } else if(electrodes_h > img.rows) {
+        electrodes_h = img.rows;
+    }
+
+    electrodes.create(electrodes_h, electrodes_w, CV_8UC(channels));
+    int blockW(img.cols / electrodes_w),
+        blockH(img.rows / electrodes_h);
+
+    //Need to cut the big picture in several small picture
+    for(int x(0); x < electrodes_w; ++x) {
+        for(int y(0); y < electrodes_h; ++y) {
+
+            //Now let's do the average of fray of the target part
+            Mat target(img, Rect(blockW * x, blockH * y, blockW, blockH));
+
+            int nRows(target.rows),
+                nCols(target.cols * channels),
+                sum[3] = {0, 0, 0};
+
+            if(target.isContinuous()) {
+                nCols *= nRows;
+                nRows = 1;
+            }
+
+            //The channels stay interleaved : pixel after pixel, one sum per channel
+            uchar const* p(nullptr);
+            for(int i(0); i < nRows; ++i) {
+                p = target.ptr<uchar>(i);
+                for(int j(0); j < nCols; j += channels) {
+                    for(int c(0); c < channels; ++c) {
+                        sum[c] += p[j + c];
+                    }
+                }
+            }
+
+            //Put this color in the target picture !
+            uchar* average(electrodes.ptr<uchar>(y) + x * channels);
+            for(int c(0); c < channels; ++c) {
+                average[c] = sum[c] / (blockH * blockW);
+            }
+        }
+    }
+}
+
+void pixeliseImage(Mat& img, int electrodes_w, int electrodes_h) {
+    Mat electrodes;
+    pixeliseImage(img, electrodes_w, electrodes_h, electrodes);
+    if(!electrodes.empty()) {
+        img = electrodes;
+    }
+}
+
+//Reverse the mat send in argument (like if you look in a spoon)
+void reverseImage(Mat& img) {
+    //Temporary matrix
+    Mat finalImg(img.rows, img.cols, CV_8UC1);
+
+    //The top-left corner pixel go the right-bottom corner
+    for(int y(0); y < img.rows; ++y) {
+        uchar* p = img.ptr<uchar>(y);
+        for(int x(0); x < img.cols; ++x) {
+            finalImg.ptr<uchar>(img.rows - y - 1)[img.cols - x - 1] = p[x];
+        }
+    }
+
+    img = finalImg;
+}
+
+void extendImage(Mat const& img, int zoom, Mat& extended) {
+    if(zoom <= 0) {
+        zoom = 1;
+    }
+
+    //Gray or BGR electrodes
+    extended.create(img.rows * zoom, img.cols * zoom, img.type());
+    int const channels(img.channels());
+
+    for(int y(0); y < img.rows; ++y) {
+        uchar const* p = img.ptr<uchar>(y);
+        for(int x(0); x < img.cols; ++x, p += channels) {
+            Scalar colour(p[0]);
+            for(int c(1); c < channels; ++c) {
+                colour[c] = p[c];
+            }
+            rectangle(extended, Point(x * zoom, y * zoom), Point((x + 1) * zoom, (y + 1) * zoom), colour, CV_FILLED);
+        }
+    }
+}
+
+void extendImage(Mat& img, int zoom) {
+    Mat finalImg;
+    extendImage(img, zoom, finalImg);
+    img = finalImg;
+}
+
+void saveImage(string const& filename, Mat& img) {
+    imwrite(filename + ".jpg", img);
+    cout << "Saved as " + filename << ".jpg\n";
+}
@@ -0,0 +1,24 @@
+#ifndef PROCESSING_H_INCLUDED
+#define PROCESSING_H_INCLUDED
+
+#include <string>
+
+#include <opencv2/core.hpp>
+
+//Steps of the simulation, in the order they are applied
+bool loadImage(cv::Mat& img, std::string filename);
+void convertImageToGrayScale(cv::Mat& img);
+void reduceImage(cv::Mat& img, int angle, double scale);
+void pixeliseImage(cv::Mat& img, int electrodes_w, int electrodes_h);
+//Same, into 'electrodes' (its memory kept when it has the size already), 'img' left as it is
+void pixeliseImage(cv::Mat const& img, int electrodes_w, int electrodes_h, cv::Mat& electrodes);
+void reverseImage(cv::Mat& img);
+void extendImage(cv::Mat& img, int zoom);
+//Same, into 'extended' (its memory kept when it has the size already), 'img' left as it is
+void extendImage(cv::Mat const& img, int zoom, cv::Mat& extended);
+void saveImage(std::string const& filename, cv::Mat& img);
+
+//Part of a cols * rows picture kept by reduceImage()
+cv::Rect reduceRect(int cols, int rows, int angle, double scale);
+
+#endif // PROCESSING_H_INCLUDED
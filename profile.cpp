@@ -0,0 +1,160 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+//Every key of the file and the member it goes to, one of the pointers being set
+struct Field {
+    char const* key;
+    int* integer;
+    bool* flag;
+    double* real;
+    string* text;
+};
+
+vector<Field> fields(Profile& profile) {
+    Field const all[] = {
+        {"electrodes_w", &profile.electrodes_w, nullptr, nullptr, nullptr},
+        {"electrodes_h", &profile.electrodes_h, nullptr, nullptr, nullptr},
+        {"angle", &profile.angle, nullptr, nullptr, nullptr},
+        {"zoom", &profile.zoom, nullptr, nullptr, nullptr},
+        {"foveated", nullptr, &profile.foveated, nullptr, nullptr},
+        {"fovea", nullptr, nullptr, &profile.fovea, nullptr},
+        {"defects", nullptr, nullptr, nullptr, &profile.defects},
+        {"levels", &profile.levels, nullptr, nullptr, nullptr},
+        {"gamma", &profile.gamma, nullptr, nullptr, nullptr},
+        {"dither", &profile.dither, nullptr, nullptr, nullptr},
+        {"integer", nullptr, &profile.integer, nullptr, nullptr},
+        {"smoothing", &profile.smoothing, nullptr, nullptr, nullptr},
+        {"spread", &profile.spread, nullptr, nullptr, nullptr},
+        {"edge_mode", &profile.edgeMode, nullptr, nullptr, nullptr},
+        {"edge_gain", &profile.edgeGain, nullptr, nullptr, nullptr},
+        {"auto_contrast", nullptr, &profile.autoContrast, nullptr, nullptr},
+        {"colour_mode", &profile.colourMode, nullptr, nullptr, nullptr},
+        {"gaze", nullptr, &profile.gaze, nullptr, nullptr},
+        {"display", &profile.displayRate, nullptr, nullptr, nullptr},
+        {"deadline", &profile.deadline, nullptr, nullptr, nullptr}
+    };
+    return vector<Field>(all, all + sizeof(all) / sizeof(all[0]));
+}
+
+int clampValue(int value, int low, int high) {
+    return min(max(value, low), high);
+}
+
+//A file edited by hand can hold anything : back into the ranges of the trackbars and of the modes,
+//the pipeline is never given a crop out of the picture
+void clampValues(Profile& profile) {
+    profile.electrodes_w = max(profile.electrodes_w, 1);
+    profile.electrodes_h = max(profile.electrodes_h, 1);
+    profile.angle = clampValue(profile.angle, 0, 100);
+    profile.zoom = clampValue(profile.zoom, 1, 20);
+    profile.fovea = min(max(profile.fovea, 0.001), 0.999);
+    profile.levels = clampValue(profile.levels, 2, 256);
+    profile.gamma = clampValue(profile.gamma, 0, 30);
+    profile.dither = clampValue(profile.dither, 0, 2);
+    profile.smoothing = clampValue(profile.smoothing, 0, 99);
+    profile.spread = clampValue(profile.spread, 0, 30);
+    profile.edgeMode = clampValue(profile.edgeMode, 0, 2);
+    profile.edgeGain = clampValue(profile.edgeGain, 0, 8);
+    profile.colourMode = clampValue(profile.colourMode, 0, 2);
+    profile.displayRate = clampValue(profile.displayRate, 1, 60);
+    profile.deadline = clampValue(profile.deadline, 0, 200);
+}
+
+}
+
+//Same defaults as the trackbars
+Profile::Profile()
+    : electrodes_w(10), electrodes_h(6), angle(100), zoom(1), foveated(false), fovea(0.1), defects("defects.txt"),
+      levels(256), gamma(10), dither(0), integer(false), smoothing(0), spread(0), edgeMode(0), edgeGain(2), autoContrast(false), colourMode(0),
+      gaze(false), displayRate(30), deadline(0) {
+}
+
+bool Profile::load(string const& filename) {
+    ifstream file(filename.c_str());
+    if(!file) {
+        return false;
+    }
+
+    vector<Field> const known(fields(*this));
+    string line;
+    int number(0);
+    while(getline(file, line)) {
+        ++number;
+        istringstream values(line);
+        string key;
+        if(!(values >> key) || key[0] == '#') {
+            continue;
+        }
+
+        bool read(false), found(false);
+        for(Field const& field : known) {
+            if(key != field.key) {
+                continue;
+            }
+            found = true;
+            if(field.integer) {
+                read = static_cast<bool>(values >> *field.integer);
+            } else if(field.flag) {
+                int flag(0);
+                read = static_cast<bool>(values >> flag);
+                *field.flag = flag != 0;
+            } else if(field.real) {
+                read = static_cast<bool>(values >> *field.real);
+            } else {
+                //The rest of the line, a file name may have spaces
+                getline(values >> ws, *field.text);
+                read = true;
+            }
+        }
+        if(!found) {
+            cout << filename << ":" << number << " : unknown key \"" << key << "\"" << endl;
+        } else if(!read) {
+            cout << filename << ":" << number << " : no value for \"" << key << "\"" << endl;
+        }
+    }
+
+    clampValues(*this);
+    cout << "Profile " << filename << " loaded" << endl;
+    return true;
+}
+
+bool Profile::save(string const& filename) const {
+    ofstream file(filename.c_str());
+    file << "# Bionic Eye profile\n";
+    for(Field const& field : fields(const_cast<Profile&>(*this))) {
+        file << field.key << " ";
+        if(field.integer) {
+            file << *field.integer;
+        } else if(field.flag) {
+            file << (*field.flag ? 1 : 0);
+        } else if(field.real) {
+            file << *field.real;
+        } else {
+            file << *field.text;
+        }
+        file << "\n";
+    }
+
+    if(!file) {
+        cout << "Could not write " << filename << endl;
+        return false;
+    }
+    cout << "Profile saved in " << filename << endl;
+    return true;
+}
+
+string layoutCacheName(string const& profile) {
+    size_t const dot(profile.find_last_of('.')),
+                 slash(profile.find_last_of("/\\"));
+    bool const extension(dot != string::npos && (slash == string::npos || dot > slash));
+    return (extension ? profile.substr(0, dot) : profile) + ".layouts";
+}
@@ -0,0 +1,48 @@
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+#include <string>
+
+//Settings of a patient and their device, kept from one session to the next instead of being set again
+//with the trackbars. Text file, one "key value" per line, '#' for the comments, the missing keys keeping
+//their default. The tables derived from it are cached next to it (see LayoutCache).
+struct Profile {
+    Profile();
+
+    bool load(std::string const& filename);
+    bool save(std::string const& filename) const;
+
+    //Layout
+    int electrodes_w, electrodes_h;
+    int angle;
+    int zoom;
+    bool foveated;
+    double fovea;
+    std::string defects; //Defect map file, empty for none
+
+    //Quantisation
+    int levels;
+    int gamma; //x10
+    int dither; //DitherMode
+
+    //Processing
+    bool integer;
+    int smoothing; //%
+    int spread;    //x10
+    int edgeMode;  //EdgeMode
+    int edgeGain;
+    bool autoContrast;
+    int colourMode; //ColourMode
+
+    //Gaze
+    bool gaze;
+
+    //Display
+    int displayRate; //Hz
+    int deadline;    //ms, 0 : the camera period
+};
+
+//Where the tables derived from a profile are cached : its name with ".layouts" instead of its extension
+std::string layoutCacheName(std::string const& profile);
+
+#endif // PROFILE_H_INCLUDED
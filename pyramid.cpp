@@ -0,0 +1,53 @@
+#include "pyramid.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+#include "processing.h"
+
+using namespace cv;
+using namespace std;
+
+ImagePyramid::ImagePyramid(int pixelsPerElectrode) : m_pixelsPerElectrode(max(pixelsPerElectrode, 1)) {
+}
+
+void ImagePyramid::reset(Mat const& img) {
+    m_levels.assign(1, img);
+}
+
+Mat const& ImagePyramid::level(int index) {
+    while(static_cast<int>(m_levels.size()) <= index) {
+        Mat const& previous(m_levels.back());
+        if(previous.cols < 2 || previous.rows < 2) {
+            break;
+        }
+
+        //Exactly half : INTER_AREA is then the mean of every 2 x 2 pixels, the odd last row or column left out
+        Mat next;
+        resize(previous, next, Size(previous.cols / 2, previous.rows / 2), 0, 0, INTER_AREA);
+        m_levels.push_back(next);
+    }
+    return m_levels[min(max(index, 0), static_cast<int>(m_levels.size()) - 1)];
+}
+
+int ImagePyramid::chooseLevel(int angle, int electrodes_w, int electrodes_h) const {
+    if(m_levels.empty() || electrodes_w <= 0 || electrodes_h <= 0) {
+        return 0;
+    }
+
+    //The crop at level 0, halved with its level : the next level is used while it keeps enough pixels
+    Mat const& picture(m_levels[0]);
+    Rect const crop(reduceRect(picture.cols, picture.rows, angle, (double)electrodes_h / (double)electrodes_w));
+    int const needW(electrodes_w * m_pixelsPerElectrode),
+              needH(electrodes_h * m_pixelsPerElectrode);
+    int index(0), cropW(crop.width), cropH(crop.height), cols(picture.cols), rows(picture.rows);
+    while(cropW / 2 >= needW && cropH / 2 >= needH && cols >= 2 && rows >= 2) {
+        cropW /= 2;
+        cropH /= 2;
+        cols /= 2;
+        rows /= 2;
+        ++index;
+    }
+    return index;
+}
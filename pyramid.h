@@ -0,0 +1,31 @@
+#ifndef PYRAMID_H_INCLUDED
+#define PYRAMID_H_INCLUDED
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//A loaded picture halved again and again, each pixel of a level being the mean of 2 x 2 pixels of the previous one.
+//The levels are only built the first time they are asked for, and kept until the next picture.
+//A 10 x 6 grid does not need the 24 million pixels of a photo : the electrodes are computed on the smallest
+//level which still gives every electrode 'pixelsPerElectrode' x 'pixelsPerElectrode' pixels.
+class ImagePyramid {
+public:
+    explicit ImagePyramid(int pixelsPerElectrode = 4);
+
+    //Level 0 is 'img' itself, not copied
+    void reset(cv::Mat const& img);
+
+    //Built on the first call. Stops at a 1 pixel wide or high level : 'index' is clamped.
+    cv::Mat const& level(int index);
+
+    //Index of the level to use for the part of the picture reduceImage() keeps with this angle and grid
+    int chooseLevel(int angle, int electrodes_w, int electrodes_h) const;
+    cv::Mat const& forGrid(int angle, int electrodes_w, int electrodes_h) { return level(chooseLevel(angle, electrodes_w, electrodes_h)); }
+
+private:
+    int m_pixelsPerElectrode;
+    std::vector<cv::Mat> m_levels;
+};
+
+#endif // PYRAMID_H_INCLUDED
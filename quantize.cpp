@@ -0,0 +1,158 @@
+#include "quantize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+//Thresholds of the 4x4 Bayer matrix, between 0 and 15
+int const bayer[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5}
+};
+
+}
+
+Quantizer::Quantizer(int levels, double gamma) : m_levels(0), m_gamma(0) {
+    configure(levels, gamma);
+}
+
+void Quantizer::configure(int levels, double gamma) {
+    levels = min(max(levels, 2), 256);
+    gamma = max(gamma, 0.1);
+    if(levels == m_levels && gamma == m_gamma) {
+        return;
+    }
+
+    m_levels = levels;
+    m_gamma = gamma;
+    m_toLevel.create(1, 256, CV_8UC1);
+    m_toFine.create(1, 256, CV_16UC1);
+    m_toGray.create(1, 256, CV_8UC1);
+
+    //Built once with floats, then the frames only use the tables
+    int const top((levels - 1) << 8);
+    for(int v(0); v < 256; ++v) {
+        int fine(cvRound(pow(v / 255.0, gamma) * top));
+        m_toFine.at<ushort>(v) = fine;
+        m_toLevel.at<uchar>(v) = (fine + 128) >> 8;
+        m_toGray.at<uchar>(v) = v < levels ? (v * 255 + (levels - 1) / 2) / (levels - 1) : 255;
+    }
+}
+
+void Quantizer::quantize(Mat const& electrodes, Mat& levels, DitherMode dither) const {
+    if(electrodes.depth() != CV_8U) {
+        return;
+    }
+
+    if(dither == DITHER_NONE) {
+        LUT(electrodes, m_toLevel, levels);
+        return;
+    }
+
+    //The channels of the BGR electrodes are dithered each on their own : the neighbours of a value are
+    //'channels' values away in the row
+    Mat fine;
+    LUT(electrodes, m_toFine, fine);
+    levels.create(electrodes.rows, electrodes.cols, electrodes.type());
+    int const top(m_levels - 1);
+    int const channels(electrodes.channels()), values(electrodes.cols * channels);
+
+    if(dither == DITHER_ORDERED) {
+        for(int y(0); y < fine.rows; ++y) {
+            ushort const* p(fine.ptr<ushort>(y));
+            uchar* out(levels.ptr<uchar>(y));
+            int const* threshold(bayer[y & 3]);
+            for(int x(0); x < values; ++x) {
+                out[x] = min((p[x] + threshold[(x / channels) & 3] * 16 + 8) >> 8, top);
+            }
+        }
+        return;
+    }
+
+    //Error diffusion : the rounding error of an electrode is given to its right and lower neighbours.
+    //errors[1] is the current row, errors[0] the next one, both with one extra electrode on each side.
+    vector<int> errors[2] = {vector<int>(values + 2 * channels, 0), vector<int>(values + 2 * channels, 0)};
+    for(int y(0); y < fine.rows; ++y) {
+        ushort const* p(fine.ptr<ushort>(y));
+        uchar* out(levels.ptr<uchar>(y));
+        int* current(&errors[1][channels]);
+        int* next(&errors[0][channels]);
+        fill(errors[0].begin(), errors[0].end(), 0);
+
+        for(int x(0); x < values; ++x) {
+            int wanted(p[x] + current[x] / 16);
+            int level(min(max((wanted + 128) >> 8, 0), top));
+            int error(wanted - (level << 8));
+            out[x] = level;
+
+            current[x + channels] += error * 7;
+            next[x - channels] += error * 3;
+            next[x] += error * 5;
+            next[x + channels] += error;
+        }
+
+        errors[0].swap(errors[1]);
+    }
+}
+
+void Quantizer::toGray(Mat const& levels, Mat& gray) const {
+    LUT(levels, m_toGray, gray);
+}
+
+int bitsPerLevel(int levels) {
+    if(levels <= 2) {
+        return 1;
+    } else if(levels <= 4) {
+        return 2;
+    } else if(levels <= 16) {
+        return 4;
+    }
+    return 8;
+}
+
+size_t packedSize(int width, int height, int bits) {
+    return (static_cast<size_t>(width) * height * bits + 7) / 8;
+}
+
+void packLevels(Mat const& levels, int bits, vector<uchar>& packed) {
+    int const values(levels.cols * levels.channels());
+    packed.assign(packedSize(values, levels.rows, bits), 0);
+    if(bits == 8) {
+        for(int y(0); y < levels.rows; ++y) {
+            memcpy(&packed[static_cast<size_t>(y) * values], levels.ptr<uchar>(y), values);
+        }
+        return;
+    }
+
+    int const perByte(8 / bits), mask((1 << bits) - 1);
+    size_t index(0);
+    for(int y(0); y < levels.rows; ++y) {
+        uchar const* p(levels.ptr<uchar>(y));
+        for(int x(0); x < values; ++x, ++index) {
+            int shift(8 - bits * (index % perByte + 1));
+            packed[index / perByte] |= (p[x] & mask) << shift;
+        }
+    }
+}
+
+void unpackLevels(uchar const* packed, int width, int height, int bits, Mat& levels, int channels) {
+    levels.create(height, width, CV_8UC(channels));
+    int const perByte(8 / bits), mask((1 << bits) - 1), values(width * channels);
+    size_t index(0);
+    for(int y(0); y < height; ++y) {
+        uchar* out(levels.ptr<uchar>(y));
+        for(int x(0); x < values; ++x, ++index) {
+            int shift(8 - bits * (index % perByte + 1));
+            out[x] = (packed[index / perByte] >> shift) & mask;
+        }
+    }
+}
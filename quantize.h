@@ -0,0 +1,51 @@
+#ifndef QUANTIZE_H_INCLUDED
+#define QUANTIZE_H_INCLUDED
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//The electrodes only support a few current levels.
+//The gray of an electrode goes through a transfer curve (gamma) and is rounded to one of 'levels' levels,
+//everything in 256 entries tables applied with cv::LUT.
+
+enum DitherMode {
+    DITHER_NONE,
+    DITHER_ORDERED,         //4x4 Bayer matrix
+    DITHER_ERROR_DIFFUSION  //Floyd-Steinberg
+};
+
+class Quantizer {
+public:
+    Quantizer(int levels = 256, double gamma = 1.0);
+
+    //The tables are only rebuilt if something changed
+    void configure(int levels, double gamma);
+    int levels() const { return m_levels; }
+
+    //Gray (CV_8UC1) -> level between 0 and levels - 1 (CV_8UC1).
+    //The BGR electrodes (CV_8UC3) give a level per channel.
+    void quantize(cv::Mat const& electrodes, cv::Mat& levels, DitherMode dither = DITHER_NONE) const;
+
+    //Level -> gray, to display the levels
+    void toGray(cv::Mat const& levels, cv::Mat& gray) const;
+
+private:
+    int m_levels;
+    double m_gamma;
+    cv::Mat m_toLevel; //Gray -> level, CV_8UC1
+    cv::Mat m_toFine;  //Gray -> level with 8 fractional bits, CV_16UC1, for the dithering
+    cv::Mat m_toGray;  //Level -> gray, CV_8UC1
+};
+
+//Smallest number of bits (1, 2, 4 or 8) able to store 'levels' levels
+int bitsPerLevel(int levels);
+
+//Levels packed 8 / bits per byte, row after row, first electrode in the most significant bits.
+//2 or 4 bits make the frames 4 or 2 times smaller on the wire and on disk.
+//The channels of an electrode follow each other, as in the Mat.
+size_t packedSize(int width, int height, int bits);
+void packLevels(cv::Mat const& levels, int bits, std::vector<uchar>& packed);
+void unpackLevels(uchar const* packed, int width, int height, int bits, cv::Mat& levels, int channels = 1);
+
+#endif // QUANTIZE_H_INCLUDED
@@ -0,0 +1,313 @@
+#include "recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "timing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+char const magic[4] = {'B', 'E', 'R', 'F'};
+uint32_t const version = 1;
+uint32_t const byteOrderMark = 0x01020304;
+
+struct RecordingHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t reserved;
+    double fps;
+};
+
+uint64_t aligned(uint64_t bytes) {
+    return (bytes + 7) & ~static_cast<uint64_t>(7);
+}
+
+}
+
+FrameRecorder::FrameRecorder() : m_frames(0), m_bytes(0) {
+}
+
+FrameRecorder::~FrameRecorder() {
+    close();
+}
+
+bool FrameRecorder::open(string const& filename, double fps) {
+    close();
+    m_file.open(filename.c_str(), ios::binary | ios::trunc);
+    if(!m_file) {
+        cout << "Could not write " << filename << endl;
+        return false;
+    }
+
+    RecordingHeader header;
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byteOrder = byteOrderMark;
+    header.reserved = 0;
+    header.fps = fps;
+    m_file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    m_filename = filename;
+    m_frames = 0;
+    m_bytes = sizeof(header);
+    return true;
+}
+
+void FrameRecorder::close() {
+    if(!m_file.is_open()) {
+        return;
+    }
+
+    m_file.close();
+    cout << m_frames << " frames (" << m_bytes / (1024 * 1024) << " MB) recorded in " << m_filename << endl;
+}
+
+void FrameRecorder::record(Mat const& frame, uint64_t timestampNs, Size mode, int fourcc) {
+    if(!m_file.is_open() || frame.empty()) {
+        return;
+    }
+
+    //The rows of a ROI are not contiguous
+    Mat const contiguous(frame.isContinuous() ? frame : frame.clone());
+    FrameRecord record;
+    record.timestampNs = timestampNs;
+    record.fourcc = fourcc;
+    record.width = mode.width;
+    record.height = mode.height;
+    record.rows = contiguous.rows;
+    record.cols = contiguous.cols;
+    record.type = contiguous.type();
+    record.bytes = contiguous.total() * contiguous.elemSize();
+
+    char const padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    m_file.write(reinterpret_cast<char const*>(&record), sizeof(record));
+    m_file.write(reinterpret_cast<char const*>(contiguous.data), record.bytes);
+    m_file.write(padding, aligned(record.bytes) - record.bytes);
+    if(!m_file) {
+        cout << "Could not write " << m_filename << ", recording stopped" << endl;
+        m_file.close();
+        return;
+    }
+    ++m_frames;
+    m_bytes += sizeof(record) + aligned(record.bytes);
+}
+
+ReplayCapture::ReplayCapture()
+    : m_data(nullptr), m_size(0), m_fps(0), m_next(0), m_current(0), m_realTime(true), m_startNs(0), m_firstTimestampNs(0), m_missed(0) {
+}
+
+ReplayCapture::~ReplayCapture() {
+    unmap();
+}
+
+bool ReplayCapture::open(String const& filename) {
+    release();
+    if(!map(filename)) {
+        return false;
+    }
+
+    //Nothing is trusted : the frames after a damaged record are left out
+    RecordingHeader header;
+    bool valid(m_size >= sizeof(header));
+    if(valid) {
+        memcpy(&header, m_data, sizeof(header));
+        valid = memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version && header.byteOrder == byteOrderMark;
+    }
+    if(!valid) {
+        cout << filename << " : not a recording of version " << version << endl;
+        unmap();
+        return false;
+    }
+    m_fps = header.fps;
+
+    size_t offset(sizeof(header));
+    while(m_size - offset >= sizeof(FrameRecord)) {
+        FrameRecord record;
+        memcpy(&record, m_data + offset, sizeof(record));
+        if(record.rows <= 0 || record.cols <= 0 || (record.type & ~CV_MAT_TYPE_MASK) != 0
+           || record.bytes != static_cast<uint64_t>(record.rows) * record.cols * CV_ELEM_SIZE(record.type)
+           || record.bytes > m_size - offset - sizeof(record)) {
+            break;
+        }
+        m_frames.push_back(offset);
+        offset += sizeof(record) + min(static_cast<size_t>(aligned(record.bytes)), m_size - offset - sizeof(record));
+    }
+
+    m_current = m_frames.size();
+    cout << filename << " : " << m_frames.size() << " frames at " << m_fps << " fps" << endl;
+    return !m_frames.empty();
+}
+
+bool ReplayCapture::open(int) {
+    return false;
+}
+
+bool ReplayCapture::isOpened() const {
+    return m_data != nullptr;
+}
+
+void ReplayCapture::release() {
+    unmap();
+    m_frames.clear();
+    m_next = 0;
+    m_current = 0;
+    m_startNs = 0;
+    m_missed = 0;
+}
+
+bool ReplayCapture::grab() {
+    if(m_next >= m_frames.size()) {
+        m_current = m_frames.size();
+        return false;
+    }
+
+    if(m_realTime) {
+        FrameRecord record;
+        memcpy(&record, m_data + m_frames[m_next], sizeof(record));
+        if(m_startNs == 0) {
+            m_startNs = monotonicNs();
+            m_firstTimestampNs = record.timestampNs;
+        }
+
+        //Late : straight to the latest frame due. Early : wait for it.
+        uint64_t const elapsed(monotonicNs() - m_startNs);
+        while(m_next + 1 < m_frames.size()) {
+            FrameRecord following;
+            memcpy(&following, m_data + m_frames[m_next + 1], sizeof(following));
+            if(following.timestampNs - m_firstTimestampNs > elapsed) {
+                break;
+            }
+            ++m_next;
+            ++m_missed;
+            record = following;
+        }
+        uint64_t const due(record.timestampNs - m_firstTimestampNs);
+        if(due > elapsed) {
+            this_thread::sleep_for(chrono::nanoseconds(due - elapsed));
+        }
+    }
+
+    m_current = m_next++;
+    return true;
+}
+
+bool ReplayCapture::retrieve(OutputArray image, int) {
+    if(m_current >= m_frames.size()) {
+        image.release();
+        return false;
+    }
+
+    FrameRecord record;
+    memcpy(&record, m_data + m_frames[m_current], sizeof(record));
+    Mat const frame(record.rows, record.cols, record.type, const_cast<uchar*>(m_data + m_frames[m_current] + sizeof(record)));
+    frame.copyTo(image);
+    return true;
+}
+
+bool ReplayCapture::read(OutputArray image) {
+    if(!grab()) {
+        image.release();
+        return false;
+    }
+    return retrieve(image);
+}
+
+bool ReplayCapture::set(int propId, double value) {
+    if(propId != CAP_PROP_POS_FRAMES || value < 0 || value >= m_frames.size()) {
+        return false;
+    }
+
+    m_next = static_cast<size_t>(value);
+    m_startNs = 0;
+    return true;
+}
+
+double ReplayCapture::get(int propId) const {
+    if(propId == CAP_PROP_FPS) {
+        return m_fps;
+    } else if(propId == CAP_PROP_FRAME_COUNT) {
+        return static_cast<double>(m_frames.size());
+    } else if(propId == CAP_PROP_POS_FRAMES) {
+        return static_cast<double>(m_next);
+    } else if(m_frames.empty()) {
+        return 0;
+    }
+
+    //The mode of the frame given last, or of the first one
+    FrameRecord record;
+    memcpy(&record, m_data + m_frames[m_current < m_frames.size() ? m_current : 0], sizeof(record));
+    if(propId == CAP_PROP_FRAME_WIDTH) {
+        return record.width;
+    } else if(propId == CAP_PROP_FRAME_HEIGHT) {
+        return record.height;
+    } else if(propId == CAP_PROP_FOURCC) {
+        return record.fourcc;
+    }
+    return 0;
+}
+
+bool ReplayCapture::map(string const& filename) {
+#ifndef _WIN32
+    int fd(::open(filename.c_str(), O_RDONLY));
+    if(fd < 0) {
+        cout << "Could not open " << filename << endl;
+        return false;
+    }
+
+    struct stat status;
+    if(fstat(fd, &status) != 0 || status.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data(mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+    ::close(fd);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    //Read from the start to the end
+    madvise(data, status.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<uchar const*>(data);
+    m_size = status.st_size;
+#else
+    //No mmap() : read at once, the recording has to fit in memory
+    ifstream file(filename.c_str(), ios::binary);
+    if(!file) {
+        cout << "Could not open " << filename << endl;
+        return false;
+    }
+    m_buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    if(m_buffer.empty()) {
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+    return true;
+}
+
+void ReplayCapture::unmap() {
+#ifndef _WIN32
+    if(m_data != nullptr) {
+        munmap(const_cast<uchar*>(m_data), m_size);
+    }
+#else
+    m_buffer.clear();
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,105 @@
+#ifndef RECORDING_H_INCLUDED
+#define RECORDING_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+//The frames of a camera session kept as they were captured (BGR or raw YUYV / NV12 buffers), with their
+//time, so the webcam path can be run again on the same frames : profiling without a camera, numbers which
+//can be compared from one build to the next.
+//
+//Layout of the file, native byte order :
+//  header : "BERF", version, byte order mark, frames per second of the camera
+//  frames : FrameRecord then its bytes, 8 bytes aligned, until the end of the file
+//There is no index : a recording cut by a crash replays up to its last complete frame.
+
+struct FrameRecord {
+    uint64_t timestampNs; //monotonicNs() when the frame was read
+    int32_t fourcc;       //Camera mode, for the raw frames
+    int32_t width, height;
+    int32_t rows, cols, type; //Of the Mat, 1 x n for most raw buffers
+    uint64_t bytes;
+};
+
+class FrameRecorder {
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    bool open(std::string const& filename, double fps);
+    void close();
+    bool isOpen() const { return m_file.is_open(); }
+
+    //'mode' and 'fourcc' : what the camera gives, as CAP_PROP_FRAME_WIDTH / HEIGHT / FOURCC say
+    void record(cv::Mat const& frame, uint64_t timestampNs, cv::Size mode, int fourcc);
+
+    size_t frames() const { return m_frames; }
+
+private:
+    FrameRecorder(FrameRecorder const&);
+    FrameRecorder& operator=(FrameRecorder const&);
+
+    std::ofstream m_file;
+    std::string m_filename;
+    size_t m_frames;
+    uint64_t m_bytes;
+};
+
+//A recording read through the VideoCapture interface, so the code written for a camera runs on it unchanged.
+//The file is memory mapped : a frame is only copied once, into the Mat given to read().
+//
+//In real time, read() waits until the frame is due, as a camera would, and gives the latest frame due when
+//the reader is late (the older ones are missed, as with a camera holding one buffer). Otherwise the frames
+//come one after the other as fast as they are read.
+//The capture properties cannot be changed : get() gives those of the recorded camera.
+class ReplayCapture : public cv::VideoCapture {
+public:
+    ReplayCapture();
+    ~ReplayCapture();
+
+    virtual bool open(cv::String const& filename);
+    virtual bool open(int index);
+    virtual bool isOpened() const;
+    virtual void release();
+
+    virtual bool grab();
+    virtual bool retrieve(cv::OutputArray image, int flag = 0);
+    virtual bool read(cv::OutputArray image);
+
+    //CAP_PROP_FPS, FRAME_WIDTH, FRAME_HEIGHT, FOURCC, FRAME_COUNT and POS_FRAMES.
+    //Only POS_FRAMES can be set, to start again from a frame.
+    virtual bool set(int propId, double value);
+    virtual double get(int propId) const;
+
+    void setRealTime(bool realTime) { m_realTime = realTime; }
+
+    //Frames skipped because the reader was late, in real time
+    size_t missed() const { return m_missed; }
+
+private:
+    ReplayCapture(ReplayCapture const&);
+    ReplayCapture& operator=(ReplayCapture const&);
+
+    bool map(std::string const& filename);
+    void unmap();
+
+    uchar const* m_data; //Whole file
+    size_t m_size;
+    std::vector<uchar> m_buffer; //The file read in memory where it cannot be mapped
+    double m_fps;
+    std::vector<size_t> m_frames; //Offset of every FrameRecord
+    size_t m_next;                //Frame grab() takes
+    size_t m_current;             //Frame retrieve() gives, m_frames.size() for none
+    bool m_realTime;
+    uint64_t m_startNs;           //monotonicNs() of the first frame given, 0 before it
+    uint64_t m_firstTimestampNs;
+    size_t m_missed;
+};
+
+#endif // RECORDING_H_INCLUDED
@@ -0,0 +1,177 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "pipeline.h"
+#include "timing.h"
+
+using namespace std;
+
+namespace {
+
+//Frames in a row before giving up a step : a single slow frame is not a trend
+int const lateFrames = 5;
+//Taking a step back needs more margin and more time, so the steps do not bounce
+int const earlyFrames = 60;
+double const earlyRatio = 0.6;
+//After a change, time for it to show (a new camera mode takes a second) before judging again
+int const settleFrames = 30;
+
+//Rate of the slower display
+int const degradedRate = 10;
+//The mean of a block costs about a quarter of its edges (one addition per pixel against two 3 x 3 filters)
+double const edgesSaving = 0.75;
+//Half the pixels per electrode in each direction : a quarter of the pixels
+double const resolutionSaving = 0.75;
+
+char const* degradationName(Degradation degradation) {
+    switch(degradation) {
+        case DEGRADE_NONE: return "full quality";
+        case DEGRADE_DISPLAY: return "slower display";
+        case DEGRADE_EDGES: return "edges off";
+        case DEGRADE_RESOLUTION: return "smaller camera mode";
+        case DEGRADE_DROP_FRAMES: return "one frame out of two dropped";
+    }
+    return "?";
+}
+
+}
+
+DeadlineScheduler::DeadlineScheduler(double deadlineMs)
+    : m_deadlineMs(deadlineMs), m_frameMs(0), m_wantedRate(0), m_wantedPixels(0), m_late(0), m_early(0), m_settle(0), m_frame(0), m_startNs(monotonicNs()) {
+}
+
+double DeadlineScheduler::deadlineFromFps(double fps) {
+    return fps > 0 ? 1000.0 / fps : 1000.0 / 30;
+}
+
+void DeadlineScheduler::setDeadline(double deadlineMs) {
+    m_deadlineMs = max(deadlineMs, 1.0);
+}
+
+double DeadlineScheduler::budgetMs() const {
+    return degraded(DEGRADE_DROP_FRAMES) ? 2 * m_deadlineMs : m_deadlineMs;
+}
+
+bool DeadlineScheduler::degraded(Degradation degradation) const {
+    for(Step const& step : m_steps) {
+        if(step.degradation == degradation) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DeadlineScheduler::skipFrame() {
+    ++m_frame;
+    return degraded(DEGRADE_DROP_FRAMES) && (m_frame & 1);
+}
+
+double DeadlineScheduler::predictSaving(Degradation degradation, Pipeline const& pipeline) const {
+    if(degraded(degradation) || !pipeline.compiled()) {
+        return 0;
+    }
+
+    if(degradation == DEGRADE_DISPLAY) {
+        //The windows are drawn by their thread : only the copies given to it, outside the pipeline, are saved
+        if(m_wantedRate <= degradedRate) {
+            return 0;
+        }
+        return max(m_frameMs - pipeline.costMs(), 0.0) * (m_wantedRate - degradedRate) / m_wantedRate;
+    }
+
+    double saving(0);
+    for(size_t i(0); i < pipeline.size(); ++i) {
+        FrameKind const input(pipeline.stageInput(i));
+        if(degradation == DEGRADE_EDGES && pipeline.stage(i).name() == "edges") {
+            saving += pipeline.stageCostMs(i) * edgesSaving;
+        } else if(degradation == DEGRADE_RESOLUTION && m_wantedPixels > 1 && input != FRAME_ELECTRODES && input != FRAME_BGR_ELECTRODES) {
+            saving += pipeline.stageCostMs(i) * resolutionSaving;
+        }
+    }
+    return saving;
+}
+
+bool DeadlineScheduler::endFrame(uint64_t frameNs, Pipeline const& pipeline) {
+    double const frameMs(frameNs / 1e6);
+    m_frameMs = m_frameMs == 0 ? frameMs : m_frameMs + (frameMs - m_frameMs) / 8;
+
+    double const judged(budgetMs());
+
+    //The step given up, or taken back
+    Step changed = {DEGRADE_NONE, 0};
+    bool down(false);
+    if(m_settle > 0) {
+        --m_settle;
+    } else if(frameMs > judged) {
+        m_early = 0;
+        if(++m_late >= lateFrames) {
+            //The biggest saving the cost model sees, dropping frames when nothing else would save anything
+            Degradation const candidates[] = {DEGRADE_DISPLAY, DEGRADE_EDGES, DEGRADE_RESOLUTION};
+            for(Degradation degradation : candidates) {
+                double const saving(predictSaving(degradation, pipeline));
+                if(saving > changed.savingMs) {
+                    changed.degradation = degradation;
+                    changed.savingMs = saving;
+                }
+            }
+            if(changed.degradation == DEGRADE_NONE && !degraded(DEGRADE_DROP_FRAMES)) {
+                changed.degradation = DEGRADE_DROP_FRAMES;
+            }
+            if(changed.degradation != DEGRADE_NONE) {
+                m_steps.push_back(changed);
+                down = true;
+            }
+        }
+    } else if(!m_steps.empty()) {
+        //The last step back costs what it saved, within the budget it leaves
+        Step const& last(m_steps.back());
+        double const budget(last.degradation == DEGRADE_DROP_FRAMES || !degraded(DEGRADE_DROP_FRAMES) ? m_deadlineMs : 2 * m_deadlineMs);
+        if(m_frameMs + last.savingMs < budget * earlyRatio) {
+            m_late = 0;
+            if(++m_early >= earlyFrames) {
+                changed = last;
+                m_steps.pop_back();
+            }
+        } else {
+            m_late = 0;
+            m_early = 0;
+        }
+    } else {
+        m_late = 0;
+        m_early = 0;
+    }
+
+    if(changed.degradation == DEGRADE_NONE) {
+        return false;
+    }
+    m_late = 0;
+    m_early = 0;
+    m_settle = settleFrames;
+
+    //When, why, and what the cost model blames
+    cout << "Scheduler at " << (monotonicNs() - m_startNs) / 1000000000.0 << " s : "
+         << m_frameMs << " ms per frame for a budget of " << judged << " ms";
+    if(pipeline.compiled() && pipeline.size() > 0) {
+        size_t const costliest(pipeline.costliestStage());
+        cout << " (pipeline " << pipeline.costMs() << " ms, " << pipeline.stage(costliest).name()
+             << " " << pipeline.stageCostMs(costliest) << " ms)";
+    }
+    cout << ", " << (down ? "giving up " : "back from ") << degradationName(changed.degradation);
+    if(changed.savingMs > 0) {
+        cout << " (" << changed.savingMs << " ms)";
+    }
+    cout << endl;
+    return true;
+}
+
+int DeadlineScheduler::displayRate(int wanted) {
+    m_wantedRate = wanted;
+    return degraded(DEGRADE_DISPLAY) ? min(wanted, degradedRate) : wanted;
+}
+
+int DeadlineScheduler::pixelsPerElectrode(int wanted) {
+    m_wantedPixels = wanted;
+    return degraded(DEGRADE_RESOLUTION) ? max(wanted / 2, 1) : wanted;
+}
@@ -0,0 +1,68 @@
+#ifndef SCHEDULER_H_INCLUDED
+#define SCHEDULER_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+class Pipeline;
+
+//What can be given up to stay within the deadline
+enum Degradation {
+    DEGRADE_NONE,
+    DEGRADE_DISPLAY,    //The windows refresh less often
+    DEGRADE_EDGES,      //Mean gray instead of the edges
+    DEGRADE_RESOLUTION, //Smaller camera mode, fewer pixels per electrode
+    DEGRADE_DROP_FRAMES //One frame out of two is not processed
+};
+
+//Keeps the processing of a frame under a deadline (the camera period, or a target latency) :
+//when the measured frames get too slow, the step the cost model of the pipeline expects to save the most
+//is given up, one at a time, and the steps come back (the last one first) when there is room again.
+//Dropping frames is the last resort, and doubles the time a processed frame may take.
+//Every change is logged with its reason.
+class DeadlineScheduler {
+public:
+    explicit DeadlineScheduler(double deadlineMs = 1000.0 / 30);
+
+    //Camera period, 30 fps when the camera does not tell
+    static double deadlineFromFps(double fps);
+    void setDeadline(double deadlineMs);
+    double deadlineMs() const { return m_deadlineMs; }
+
+    //Time a processed frame may take : the deadline, twice it when one frame out of two is dropped
+    double budgetMs() const;
+
+    bool degraded(Degradation degradation) const;
+
+    //At DEGRADE_DROP_FRAMES, true for one frame out of two : read it and throw it away
+    bool skipFrame();
+
+    //Time the frame took, from the picture read to the electrodes sent, and the pipeline which ran,
+    //for its cost model. Returns true if a step was given up or back.
+    bool endFrame(uint64_t frameNs, Pipeline const& pipeline);
+
+    //Display rate and pixels per electrode allowed by the steps given up, from the wanted ones
+    //(kept to predict what giving them up would save)
+    int displayRate(int wanted);
+    int pixelsPerElectrode(int wanted);
+
+private:
+    struct Step {
+        Degradation degradation;
+        double savingMs; //Predicted when it was given up
+    };
+
+    //What giving up 'degradation' should save on a processed frame, 0 if nothing
+    double predictSaving(Degradation degradation, Pipeline const& pipeline) const;
+
+    double m_deadlineMs;
+    double m_frameMs; //Smoothed
+    std::vector<Step> m_steps; //Given up, in that order
+    int m_wantedRate, m_wantedPixels;
+    int m_late, m_early; //Frames in a row over the budget, or well under it
+    int m_settle;        //Frames left before the last change is judged
+    unsigned int m_frame;
+    uint64_t m_startNs;
+};
+
+#endif // SCHEDULER_H_INCLUDED
@@ -0,0 +1,398 @@
+#include "selfcheck.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "contrast.h"
+#include "defects.h"
+#include "fixedpoint.h"
+#include "frameview.h"
+#include "pipeline.h"
+#include "pixelisekernels.h"
+#include "processing.h"
+#include "quantize.h"
+#include "stages.h"
+#include "streaming.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+enum VariantId {
+    REDUCE_FIXED,
+    PIXELISE_FIXED,
+    PIXELISE_KERNEL,
+    PIXELISE_DEFECTS,
+    PIXELISE_VIEW_GRAY8,
+    PIXELISE_VIEW_BGR24,
+    PIXELISE_VIEW_BGRA32,
+    PIXELISE_VIEW_YUYV,
+    PIXELISE_STREAMING,
+    PIXELISE_BGR_CHANNELS,
+    PIXELISE_BGR_FIXED,
+    PIXELISE_STAGE_BUFFER,
+    PIPELINE_FUSED,
+    PIPELINE_WATCHED,
+    PIPELINE_BGR,
+    PIPELINE_BGR_LEVELS,
+    REVERSE_STAGE,
+    REVERSE_STAGE_BUFFER,
+    EXTEND_DEFINITION,
+    EXTEND_STAGE,
+    EXTEND_STAGE_BUFFER,
+    EXTEND_BGR,
+    VARIANT_COUNT
+};
+
+char const* const variantNames[VARIANT_COUNT] = {
+    "reduceRectFixed(), against reduceRect()",
+    "pixeliseImageFixed()",
+    "pixeliseImageDispatch(), specialised grids",
+    "DefectMap::pixelise(), no defect",
+    "pixeliseView(), GRAY8",
+    "pixeliseView(), BGR24",
+    "pixeliseView(), BGRA32",
+    "pixeliseView(), YUYV",
+    "StreamingReducer",
+    "pixeliseImage(), BGR against every channel alone",
+    "pixeliseImageFixed(), BGR",
+    "PixeliseStage, in the buffer of the caller",
+    "pipeline, fused",
+    "pipeline, every stage watched",
+    "pipeline, BGR electrodes",
+    "pipeline, BGR electrodes to the packed levels",
+    "ReverseStage",
+    "ReverseStage, in the buffer of the caller",
+    "extendImage(), against its definition",
+    "ExtendStage",
+    "ExtendStage, in the buffer of the caller",
+    "extendImage(), BGR"
+};
+
+struct Result {
+    int runs;
+    int errors;
+    string firstError; //Geometry of the first difference, to reproduce it
+};
+
+bool same(Mat const& a, Mat const& b) {
+    if(a.size() != b.size() || a.type() != b.type()) {
+        return false;
+    }
+    size_t const bytes(a.cols * a.elemSize());
+    for(int y(0); y < a.rows; ++y) {
+        if(memcmp(a.ptr(y), b.ptr(y), bytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Random bytes, or all at 255 one time in eight : the biggest sums the divisions can get
+Mat randomPicture(RNG& rng, int rows, int cols, int type) {
+    Mat img(rows, cols, type);
+    bool const saturated(rng.uniform(0, 8) == 0);
+    for(int y(0); y < rows; ++y) {
+        uchar* p(img.ptr<uchar>(y));
+        for(size_t x(0); x < cols * img.elemSize(); ++x) {
+            p[x] = saturated ? 255 : static_cast<uchar>(rng.uniform(0, 256));
+        }
+    }
+    return img;
+}
+
+//One size in four of 1 or 2 pixels, odd sizes as often as even ones otherwise
+int randomSize(RNG& rng, int maximum) {
+    return rng.uniform(0, 4) == 0 ? rng.uniform(1, 3) : rng.uniform(1, maximum);
+}
+
+//0, bigger than any picture, or in between
+int randomGrid(RNG& rng, int maximum) {
+    switch(rng.uniform(0, 8)) {
+        case 0: return 0;
+        case 1: return maximum * 8;
+        default: return rng.uniform(1, maximum);
+    }
+}
+
+}
+
+bool checkKernelVariants(int iterations) {
+    RNG rng(0x4B45524E);
+    vector<Result> results(VARIANT_COUNT, Result{0, 0, ""});
+
+    //Kept from one picture to the next, so the reuse of their buffers is checked too
+    Pipeline fused, watched, colour;
+    for(Pipeline* pipeline : {&fused, &watched}) {
+        pipeline->add(new GrayStage(true));
+        pipeline->add(new ReduceStage(true));
+        pipeline->add(new PixeliseStage(true));
+    }
+    watched.watchAll();
+    colour.add(new ReduceStage(true));
+    colour.add(new PixeliseStage(true));
+    //BGR electrodes to the stimulator : no smoothing and 256 levels leave them as they are, reversed
+    Pipeline colourLevels;
+    TemporalFilterFixed noSmoothing;
+    Quantizer allLevels;
+    Mat levels, unpacked;
+    vector<uchar> packed;
+    colourLevels.add(new ReduceStage(true));
+    colourLevels.add(new PixeliseStage(true));
+    colourLevels.add(new TemporalStage(noSmoothing));
+    colourLevels.add(new ReverseStage);
+    colourLevels.add(new QuantizeStage(allLevels, DITHER_NONE, levels));
+    DefectMap noDefect;
+    PixeliseStage pixeliseFixed(true), pixeliseDispatch(false);
+    ReverseStage reverse;
+    ExtendStage extend;
+
+    //The grids of the specialised kernels, one geometry in four
+    int const knownGrids[][2] = {{10, 6}, {16, 16}, {32, 32}, {100, 60}};
+
+    for(int i(0); i < iterations; ++i) {
+        int const cols(randomSize(rng, 700)), rows(randomSize(rng, 500)), angle(rng.uniform(0, 101)), zoom(rng.uniform(-2, 7));
+        int electrodes_w(randomGrid(rng, 120)), electrodes_h(randomGrid(rng, 80));
+        if(rng.uniform(0, 4) == 0) {
+            int const* grid(knownGrids[rng.uniform(0, 4)]);
+            electrodes_w = grid[0];
+            electrodes_h = grid[1];
+        }
+        ostringstream geometry;
+        geometry << cols << "x" << rows << " angle " << angle << " grid " << electrodes_w << "x" << electrodes_h << " zoom " << zoom;
+        auto check = [&](VariantId variant, bool matches) {
+            Result& result(results[variant]);
+            ++result.runs;
+            if(!matches && result.errors++ == 0) {
+                result.firstError = geometry.str();
+            }
+        };
+
+        Mat const bgr(randomPicture(rng, rows, cols, CV_8UC3));
+
+        //Reference : the scalar steps of processing.cpp, guards included
+        Mat gray;
+        cvtColor(bgr, gray, COLOR_BGR2GRAY);
+        Mat reduced(gray);
+        reduceImage(reduced, angle, (double)electrodes_h / (double)electrodes_w);
+        Mat reference(reduced);
+        pixeliseImage(reference, electrodes_w, electrodes_h);
+
+        Rect const crop(reduceRectFixed(cols, rows, angle, electrodes_w, electrodes_h));
+        check(REDUCE_FIXED, crop == reduceRect(cols, rows, angle, (double)electrodes_h / (double)electrodes_w)
+                            && reduced.size() == crop.size() && reduced.data == gray.ptr(crop.y, crop.x));
+
+        //The variants converting to gray on their own use the integer luma, which OpenCV may round
+        //differently on a few pixels : their reference is the same crop of that gray
+        Mat grayFixed;
+        convertImageToGrayScaleFixed(bgr, grayFixed);
+        Mat referenceFixedLuma(grayFixed, crop);
+        pixeliseImage(referenceFixedLuma, electrodes_w, electrodes_h);
+
+        Mat electrodes(reduced);
+        pixeliseImageFixed(electrodes, electrodes_w, electrodes_h);
+        check(PIXELISE_FIXED, same(electrodes, reference));
+
+        if(hasPixeliseKernel(electrodes_w, electrodes_h)) {
+            electrodes = reduced;
+            pixeliseImageDispatch(electrodes, electrodes_w, electrodes_h);
+            check(PIXELISE_KERNEL, same(electrodes, reference));
+        }
+
+        noDefect.pixelise(reduced, electrodes_w, electrodes_h, electrodes);
+        check(PIXELISE_DEFECTS, same(electrodes, reference));
+
+        //The views, on the whole frame with the crop
+        Mat bgra(rows, cols, CV_8UC4), yuyv(rows, cols, CV_8UC2);
+        for(int y(0); y < rows; ++y) {
+            uchar const* p(bgr.ptr<uchar>(y));
+            uchar const* g(gray.ptr<uchar>(y));
+            uchar* q(bgra.ptr<uchar>(y));
+            uchar* r(yuyv.ptr<uchar>(y));
+            for(int x(0); x < cols; ++x, p += 3, q += 4, r += 2) {
+                q[0] = p[0];
+                q[1] = p[1];
+                q[2] = p[2];
+                q[3] = static_cast<uchar>(rng.uniform(0, 256));
+                r[0] = g[x];
+                r[1] = static_cast<uchar>(rng.uniform(0, 256));
+            }
+        }
+        struct {
+            VariantId variant;
+            Mat const* frame;
+            PixelFormat format;
+            Mat const* expected;
+        } const views[] = {
+            {PIXELISE_VIEW_GRAY8, &gray, PIXEL_GRAY8, &reference},
+            {PIXELISE_VIEW_BGR24, &bgr, PIXEL_BGR24, &referenceFixedLuma},
+            {PIXELISE_VIEW_BGRA32, &bgra, PIXEL_BGRA32, &referenceFixedLuma},
+            {PIXELISE_VIEW_YUYV, &yuyv, PIXEL_YUYV, &reference}
+        };
+        for(auto const& view : views) {
+            FrameView const frame = {view.frame->data, cols, rows, view.frame->step, view.format};
+            electrodes.create(reference.size(), CV_8UC1);
+            ElectrodeView const out = {electrodes.data, electrodes.cols, electrodes.rows, electrodes.step};
+            check(view.variant, pixeliseView(frame, crop, electrodes_w, electrodes_h, out) && same(electrodes, *view.expected));
+        }
+
+        StreamingReducer reducer(cols, rows, angle, electrodes_w, electrodes_h);
+        for(int y(0); !reducer.done(); ++y) {
+            reducer.addRow(reduced.ptr<uchar>(y));
+        }
+        check(PIXELISE_STREAMING, reducer.crop() == crop && same(reducer.electrodes(), reference));
+
+        //BGR : the same averages, channel by channel
+        Mat reducedBgr(bgr);
+        reduceImage(reducedBgr, angle, (double)electrodes_h / (double)electrodes_w);
+        Mat referenceBgr(reducedBgr);
+        pixeliseImage(referenceBgr, electrodes_w, electrodes_h);
+        bool channelsMatch(referenceBgr.type() == CV_8UC3);
+        for(int c(0); channelsMatch && c < 3; ++c) {
+            Mat channel(reducedBgr.size(), CV_8UC1);
+            for(int y(0); y < channel.rows; ++y) {
+                for(int x(0); x < channel.cols; ++x) {
+                    channel.at<uchar>(y, x) = reducedBgr.ptr<uchar>(y)[3 * x + c];
+                }
+            }
+            pixeliseImage(channel, electrodes_w, electrodes_h);
+            channelsMatch = channel.size() == referenceBgr.size();
+            for(int y(0); channelsMatch && y < channel.rows; ++y) {
+                for(int x(0); channelsMatch && x < channel.cols; ++x) {
+                    channelsMatch = channel.at<uchar>(y, x) == referenceBgr.ptr<uchar>(y)[3 * x + c];
+                }
+            }
+        }
+        check(PIXELISE_BGR_CHANNELS, channelsMatch);
+
+        electrodes = reducedBgr;
+        pixeliseImageFixed(electrodes, electrodes_w, electrodes_h);
+        check(PIXELISE_BGR_FIXED, same(electrodes, referenceBgr));
+
+        PipelineSettings settings;
+        settings.angle = angle;
+        settings.electrodes_w = electrodes_w;
+        settings.electrodes_h = electrodes_h;
+        settings.zoom = zoom;
+        for(PixeliseStage* stage : {&pixeliseFixed, &pixeliseDispatch}) {
+            Mat buffer(reference.size(), CV_8UC1);
+            uchar* const data(buffer.data);
+            check(PIXELISE_STAGE_BUFFER, stage->run(reduced, buffer, settings) && buffer.data == data && same(buffer, reference));
+        }
+        check(PIPELINE_FUSED, fused.run(bgr, settings, electrodes) && same(electrodes, referenceFixedLuma));
+        check(PIPELINE_WATCHED, watched.run(bgr, settings, electrodes) && same(electrodes, referenceFixedLuma));
+        check(PIPELINE_BGR, colour.run(bgr, settings, electrodes) && same(electrodes, referenceBgr));
+
+        Mat reversedBgr;
+        flip(referenceBgr, reversedBgr, -1);
+        bool levelsMatch(colourLevels.run(bgr, settings, electrodes) && same(electrodes, reversedBgr) && same(levels, reversedBgr));
+        if(levelsMatch) {
+            packLevels(levels, 8, packed);
+            unpackLevels(packed.data(), levels.cols, levels.rows, 8, unpacked, levels.channels());
+            levelsMatch = same(unpacked, levels);
+        }
+        check(PIPELINE_BGR_LEVELS, levelsMatch);
+
+        //Reverse, of the electrodes and of a whole crop (a view, its rows not contiguous)
+        for(Mat const* picture : {&reference, &reduced}) {
+            Mat reversed(*picture);
+            reverseImage(reversed);
+
+            Mat out;
+            check(REVERSE_STAGE, reverse.run(*picture, out, settings) && same(out, reversed));
+            Mat buffer(picture->size(), CV_8UC1);
+            uchar* const data(buffer.data);
+            check(REVERSE_STAGE_BUFFER, reverse.run(*picture, buffer, settings) && buffer.data == data && same(buffer, reversed));
+        }
+
+        //Extend : every pixel of a zoom x zoom square is its electrode, zoom <= 0 being 1
+        Mat extended(reference);
+        extendImage(extended, zoom);
+        int const scale(max(zoom, 1));
+        bool matches(extended.rows == reference.rows * scale && extended.cols == reference.cols * scale);
+        for(int y(0); matches && y < extended.rows; ++y) {
+            for(int x(0); matches && x < extended.cols; ++x) {
+                matches = extended.at<uchar>(y, x) == reference.at<uchar>(y / scale, x / scale);
+            }
+        }
+        check(EXTEND_DEFINITION, matches);
+
+        Mat out;
+        check(EXTEND_STAGE, extend.run(reference, out, settings) && same(out, extended));
+        Mat buffer(extended.size(), CV_8UC1, Scalar(7));
+        uchar* const data(buffer.data);
+        check(EXTEND_STAGE_BUFFER, extend.run(reference, buffer, settings) && buffer.data == data && same(buffer, extended));
+
+        Mat extendedBgr(referenceBgr);
+        extendImage(extendedBgr, zoom);
+        matches = extendedBgr.type() == CV_8UC3 && extendedBgr.rows == referenceBgr.rows * scale && extendedBgr.cols == referenceBgr.cols * scale;
+        for(int y(0); matches && y < extendedBgr.rows; ++y) {
+            for(int x(0); matches && x < extendedBgr.cols; ++x) {
+                matches = extendedBgr.at<Vec3b>(y, x) == referenceBgr.at<Vec3b>(y / scale, x / scale);
+            }
+        }
+        check(EXTEND_BGR, matches);
+    }
+
+    bool ok(true);
+    cout << "Kernel variants, " << iterations << " random pictures :\n";
+    for(int v(0); v < VARIANT_COUNT; ++v) {
+        Result const& result(results[v]);
+        cout << "  " << variantNames[v] << " : " << result.runs << " runs, " << result.errors << " errors";
+        if(result.errors > 0) {
+            cout << " (first with " << result.firstError << ")";
+            ok = false;
+        }
+        cout << "\n";
+    }
+    cout << (ok ? "Every variant matches the reference" : "Some variants differ from the reference, do not use them") << endl;
+    return ok;
+}
+
+bool checkContrastWithDefects() {
+    //10 x 6 grid, a fifth of the electrodes dead or stuck : far more than the 2 % the clipping ignores
+    string const filename("selfcheck_defects.txt");
+    {
+        ofstream file(filename.c_str());
+        for(int i(0); i < 12; ++i) {
+            file << (i * 7) % 10 << " " << i / 2 << (i % 2 == 0 ? " dead\n" : " stuck 250\n");
+        }
+    }
+    DefectMap defects;
+    bool const loaded(defects.load(filename));
+    remove(filename.c_str());
+    if(!loaded) {
+        cout << "Contrast with defects : could not write " << filename << endl;
+        return false;
+    }
+
+    //A dim scene : the working electrodes between 100 and 139, the others at 0 as DefectMap::pixelise() leaves them
+    Mat live, electrodes(6, 10, CV_8UC1);
+    defects.liveMask(electrodes.cols, electrodes.rows, live);
+    AdaptiveContrast contrast;
+    ContrastStage stage(contrast, &defects);
+    PipelineSettings settings;
+    for(int frame(0); frame < 50; ++frame) {
+        for(int y(0); y < electrodes.rows; ++y) {
+            for(int x(0); x < electrodes.cols; ++x) {
+                electrodes.at<uchar>(y, x) = live.at<uchar>(y, x) != 0 ? 100 + (y * electrodes.cols + x) % 40 : 0;
+            }
+        }
+        stage.run(electrodes, electrodes, settings);
+    }
+
+    bool const ok(contrast.low() >= 95 && contrast.high() <= 145);
+    cout << "Contrast with " << defects.size() << " defective electrodes : bounds " << contrast.low() << " to " << contrast.high()
+         << (ok ? ", the defective electrodes are left out" : ", held by the defective electrodes") << endl;
+    return ok;
+}
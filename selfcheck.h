@@ -0,0 +1,15 @@
+#ifndef SELFCHECK_H_INCLUDED
+#define SELFCHECK_H_INCLUDED
+
+//Every variant of reduceImage(), pixeliseImage(), reverseImage() and extendImage() (integer, specialised, fused, streaming,
+//in place, BGR...) against the scalar reference of processing.cpp, on random pictures and geometries, with the cases
+//the reference guards against (grid of 0 or bigger than the picture, odd sizes, 1 pixel wide, zoom <= 0).
+//The electrodes must match exactly. A new variant of a kernel gets its line here before being used.
+//Prints one line per variant, returns false if one of them differs.
+bool checkKernelVariants(int iterations);
+
+//AdaptiveContrast with a defect map : the dead and stuck electrodes, left at 0 by the pixelisation,
+//must not hold the bounds. Returns false if they do.
+bool checkContrastWithDefects();
+
+#endif // SELFCHECK_H_INCLUDED
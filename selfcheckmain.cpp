@@ -0,0 +1,26 @@
+//The self checks of the simulator (menu 4), without camera nor window, for the scripts and the build machines.
+//
+//  SelfCheck [n]     n random pictures per check (1000 by default)
+//
+//Returns 0 when every check passes, 1 otherwise.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "fixedpoint.h"
+#include "selfcheck.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    int const iterations(argc > 1 ? max(1, atoi(argv[1])) : 1000);
+
+    //All of them run, a failure does not hide the next ones
+    bool ok(checkFixedPointPipeline(iterations));
+    ok = checkKernelVariants(iterations) && ok;
+    ok = checkContrastWithDefects() && ok;
+
+    cout << (ok ? "Every check passed" : "Some checks failed") << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+//Small reader for the electrode frames published by the simulator in shared memory.
+//
+//  ShmReader [name]             print the frames received and the latency every second
+//  ShmReader --dump [name]      same, and print every electrode frame
+//  ShmReader --selftest [n]     publish n synthetic frames from a thread and read them back,
+//                               to measure the publisher -> reader latency and check no frame is torn
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shmring.h"
+#include "timing.h"
+
+using namespace std;
+
+namespace {
+
+struct LatencyStats {
+    vector<uint64_t> samples;
+
+    void print(string const& prefix) {
+        if(samples.empty()) {
+            cout << prefix << "no frame" << endl;
+            return;
+        }
+
+        sort(samples.begin(), samples.end());
+        cout << prefix << samples.size() << " frames, latency (us) min " << samples.front() / 1000
+             << " median " << samples[samples.size() / 2] / 1000
+             << " p99 " << samples[samples.size() * 99 / 100] / 1000
+             << " max " << samples.back() / 1000 << endl;
+        samples.clear();
+    }
+};
+
+//The channels of a BGR electrode as b/g/r
+void dumpFrame(ShmFrame const& frame) {
+    size_t index(0);
+    for(int y(0); y < frame.height; ++y) {
+        for(int x(0); x < frame.width; ++x) {
+            for(int c(0); c < frame.channels; ++c, ++index) {
+                cout << static_cast<int>(frame.data[index]) << (c + 1 < frame.channels ? "/" : "");
+            }
+            cout << (x + 1 < frame.width ? " " : "\n");
+        }
+    }
+}
+
+int read(string const& name, bool dump) {
+    ShmSubscriber subscriber;
+    cout << "Waiting for " << name << "..." << endl;
+    while(!subscriber.open(name)) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    cout << "Attached to " << name << endl;
+
+    ShmFrame frame;
+    LatencyStats stats;
+    uint32_t lastSeen(subscriber.lastFrame());
+    unsigned int retries(0), missed(0);
+    uint64_t nextReport(monotonicNs() + 1000000000ull);
+
+    while(true) {
+        if(subscriber.lastFrame() != lastSeen && subscriber.readLatest(frame, retries)) {
+            stats.samples.push_back(monotonicNs() - frame.timestampNs);
+            if(lastSeen != 0 && frame.frame > lastSeen + 1) {
+                missed += frame.frame - lastSeen - 1;
+            }
+            lastSeen = frame.frame;
+
+            if(dump) {
+                cout << "Frame " << frame.frame << " (" << frame.width << " x " << frame.height
+                     << (frame.channels == 3 ? ", BGR" : "") << ")\n";
+                dumpFrame(frame);
+            }
+        } else {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+
+        if(monotonicNs() >= nextReport) {
+            stats.print("");
+            cout << "  missed " << missed << ", retried " << retries << endl;
+            missed = 0;
+            retries = 0;
+            nextReport += 1000000000ull;
+        }
+    }
+
+    return 0;
+}
+
+int selfTest(int frames) {
+    string name("/bionic_eye_selftest");
+    ShmPublisher publisher;
+    if(!publisher.open(name, 100, 60)) {
+        return 1;
+    }
+
+    ShmSubscriber subscriber;
+    if(!subscriber.open(name)) {
+        cout << "Could not attach to " << name << endl;
+        return 1;
+    }
+
+    //Every frame is filled with its own number, so a torn copy is easy to see
+    atomic<bool> done(false);
+    thread writer([&]() {
+        for(int i(1); i <= frames; ++i) {
+            uchar* data(publisher.beginFrame(100, 60));
+            memset(data, i & 0xFF, 100 * 60);
+            publisher.commit();
+            this_thread::sleep_for(chrono::microseconds(500));
+        }
+        done = true;
+    });
+
+    ShmFrame frame;
+    LatencyStats stats;
+    uint32_t lastSeen(0);
+    unsigned int retries(0), torn(0), received(0);
+    while(!done || subscriber.lastFrame() != lastSeen) {
+        if(subscriber.lastFrame() == lastSeen || !subscriber.readLatest(frame, retries)) {
+            continue;
+        }
+
+        stats.samples.push_back(monotonicNs() - frame.timestampNs);
+        lastSeen = frame.frame;
+        ++received;
+
+        uchar expected(frame.frame & 0xFF);
+        for(size_t i(0); i < frame.data.size(); ++i) {
+            if(frame.data[i] != expected) {
+                ++torn;
+                break;
+            }
+        }
+    }
+    writer.join();
+
+    stats.print("Self test : ");
+    cout << "  published " << frames << ", received " << received << ", retried " << retries << ", torn " << torn << endl;
+    return torn == 0 ? 0 : 1;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    string name("/bionic_eye");
+    bool dump(false);
+
+    for(int i(1); i < argc; ++i) {
+        string arg(argv[i]);
+        if(arg == "--dump") {
+            dump = true;
+        } else if(arg == "--selftest") {
+            return selfTest(i + 1 < argc ? max(1, atoi(argv[i + 1])) : 10000);
+        } else {
+            name = arg;
+        }
+    }
+
+    return read(name, dump);
+}
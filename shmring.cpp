@@ -0,0 +1,300 @@
+#include "shmring.h"
+
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "timing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+size_t slotOffset(ShmRingHeader const* header, uint32_t index) {
+    return sizeof(ShmRingHeader) + static_cast<size_t>(index) * header->slotSize;
+}
+
+ShmSlotHeader* slotAt(ShmRingHeader* header, uint32_t index) {
+    return reinterpret_cast<ShmSlotHeader*>(reinterpret_cast<uchar*>(header) + slotOffset(header, index));
+}
+
+ShmSlotHeader const* slotAt(ShmRingHeader const* header, uint32_t index) {
+    return reinterpret_cast<ShmSlotHeader const*>(reinterpret_cast<uchar const*>(header) + slotOffset(header, index));
+}
+
+}
+
+ShmPublisher::ShmPublisher() : m_header(nullptr), m_size(0), m_frame(0), m_writing(nullptr) {
+}
+
+ShmPublisher::~ShmPublisher() {
+    close();
+}
+
+#ifndef _WIN32
+
+bool ShmPublisher::open(string const& name, int maxWidth, int maxHeight, int slotCount, int maxChannels) {
+    close();
+
+    if(maxWidth <= 0 || maxHeight <= 0 || maxWidth > 0xFFFF || maxHeight > 0xFFFF || slotCount <= 0
+       || (maxChannels != 1 && maxChannels != 3)) {
+        cout << "Shared memory : invalid geometry" << endl;
+        return false;
+    }
+
+    //Slots start on a cache line (after the 64 bytes of the header) so two slots are never written through the same line
+    static_assert(sizeof(ShmRingHeader) == 64, "the slots must start on a cache line");
+    size_t slotSize((sizeof(ShmSlotHeader) + static_cast<size_t>(maxWidth) * maxHeight * maxChannels + 63) & ~static_cast<size_t>(63));
+    size_t size(sizeof(ShmRingHeader) + slotSize * slotCount);
+
+    int fd(shm_open(name.c_str(), O_CREAT | O_RDWR, 0644));
+    if(fd < 0) {
+        cout << "Shared memory : could not create " << name << endl;
+        return false;
+    }
+    if(ftruncate(fd, size) != 0) {
+        cout << "Shared memory : could not resize " << name << endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* memory(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    ::close(fd);
+    if(memory == MAP_FAILED) {
+        cout << "Shared memory : could not map " << name << endl;
+        return false;
+    }
+
+    //Readers check the magic last, so they never see a half initialised header
+    ShmRingHeader* header(static_cast<ShmRingHeader*>(memory));
+    header->magic = 0;
+    header->version = SHM_RING_VERSION;
+    header->slotCount = slotCount;
+    header->slotSize = slotSize;
+    header->maxWidth = maxWidth;
+    header->maxHeight = maxHeight;
+    new (&header->lastFrame) atomic<uint32_t>(0);
+    header->maxChannels = maxChannels;
+    memset(header->reserved, 0, sizeof(header->reserved));
+    for(int i(0); i < slotCount; ++i) {
+        ShmSlotHeader* slot(slotAt(header, i));
+        new (&slot->sequence) atomic<uint32_t>(0);
+        slot->frame = 0;
+        slot->width = 0;
+        slot->height = 0;
+        slot->channels = 0;
+        slot->reserved = 0;
+        slot->timestampNs = 0;
+    }
+    atomic_thread_fence(memory_order_release);
+    header->magic = SHM_RING_MAGIC;
+
+    m_name = name;
+    m_header = header;
+    m_size = size;
+    m_frame = 0;
+    return true;
+}
+
+void ShmPublisher::close() {
+    if(m_header == nullptr) {
+        return;
+    }
+
+    munmap(m_header, m_size);
+    shm_unlink(m_name.c_str());
+    m_header = nullptr;
+    m_writing = nullptr;
+    m_size = 0;
+}
+
+#else
+
+bool ShmPublisher::open(string const& name, int, int, int, int) {
+    cout << "Shared memory : POSIX shared memory is not available, " << name << " not created" << endl;
+    return false;
+}
+
+void ShmPublisher::close() {
+}
+
+#endif
+
+uchar* ShmPublisher::beginFrame(int width, int height, int channels) {
+    if(m_header == nullptr || width <= 0 || height <= 0 || channels <= 0
+       || static_cast<uint32_t>(width) > m_header->maxWidth || static_cast<uint32_t>(height) > m_header->maxHeight
+       || static_cast<uint32_t>(channels) > m_header->maxChannels) {
+        return nullptr;
+    }
+
+    ++m_frame;
+    if(m_frame == 0) { //0 means "no frame"
+        m_frame = 1;
+    }
+
+    m_writing = slotAt(m_header, m_frame % m_header->slotCount);
+
+    //Odd sequence : the slot is being written
+    uint32_t sequence(m_writing->sequence.load(memory_order_relaxed));
+    m_writing->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    m_writing->frame = m_frame;
+    m_writing->width = width;
+    m_writing->height = height;
+    m_writing->channels = channels;
+
+    return reinterpret_cast<uchar*>(m_writing + 1);
+}
+
+void ShmPublisher::commit() {
+    if(m_writing == nullptr) {
+        return;
+    }
+
+    m_writing->timestampNs = monotonicNs();
+    m_writing->sequence.store(m_writing->sequence.load(memory_order_relaxed) + 1, memory_order_release);
+    m_header->lastFrame.store(m_frame, memory_order_release);
+    m_writing = nullptr;
+}
+
+bool ShmPublisher::publish(Mat const& electrodes) {
+    if(electrodes.type() != CV_8UC1 && electrodes.type() != CV_8UC3) {
+        return false;
+    }
+
+    uchar* data(beginFrame(electrodes.cols, electrodes.rows, electrodes.channels()));
+    if(data == nullptr) {
+        return false;
+    }
+
+    size_t const row(electrodes.cols * electrodes.elemSize());
+    for(int y(0); y < electrodes.rows; ++y) {
+        memcpy(data + y * row, electrodes.ptr<uchar>(y), row);
+    }
+
+    commit();
+    return true;
+}
+
+ShmSubscriber::ShmSubscriber() : m_header(nullptr), m_size(0) {
+}
+
+ShmSubscriber::~ShmSubscriber() {
+    close();
+}
+
+#ifndef _WIN32
+
+bool ShmSubscriber::open(string const& name) {
+    close();
+
+    int fd(shm_open(name.c_str(), O_RDONLY, 0));
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ShmRingHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size(info.st_size);
+    void* memory(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+    ::close(fd);
+    if(memory == MAP_FAILED) {
+        return false;
+    }
+
+    ShmRingHeader const* header(static_cast<ShmRingHeader const*>(memory));
+    atomic_thread_fence(memory_order_acquire);
+    if(header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION
+       || header->slotCount == 0 || header->maxChannels == 0
+       || sizeof(ShmRingHeader) + static_cast<size_t>(header->slotSize) * header->slotCount > size) {
+        munmap(memory, size);
+        return false;
+    }
+
+    m_header = header;
+    m_size = size;
+    return true;
+}
+
+void ShmSubscriber::close() {
+    if(m_header == nullptr) {
+        return;
+    }
+
+    munmap(const_cast<ShmRingHeader*>(m_header), m_size);
+    m_header = nullptr;
+    m_size = 0;
+}
+
+#else
+
+bool ShmSubscriber::open(string const&) {
+    return false;
+}
+
+void ShmSubscriber::close() {
+}
+
+#endif
+
+uint32_t ShmSubscriber::lastFrame() const {
+    if(m_header == nullptr) {
+        return 0;
+    }
+
+    return m_header->lastFrame.load(memory_order_acquire);
+}
+
+bool ShmSubscriber::readLatest(ShmFrame& out, unsigned int& retries, int maxRetries) const {
+    if(m_header == nullptr) {
+        return false;
+    }
+
+    for(int attempt(0); attempt < maxRetries; ++attempt) {
+        uint32_t frame(m_header->lastFrame.load(memory_order_acquire));
+        if(frame == 0) {
+            return false;
+        }
+
+        ShmSlotHeader const* slot(slotAt(m_header, frame % m_header->slotCount));
+        uint32_t before(slot->sequence.load(memory_order_acquire));
+        if(before & 1) {
+            ++retries;
+            continue;
+        }
+
+        out.frame = slot->frame;
+        out.width = slot->width;
+        out.height = slot->height;
+        out.channels = slot->channels;
+        out.timestampNs = slot->timestampNs;
+        size_t bytes(static_cast<size_t>(out.width) * out.height * out.channels);
+        if(static_cast<uint32_t>(out.channels) > m_header->maxChannels || bytes > m_header->maxWidth * static_cast<size_t>(m_header->maxHeight) * m_header->maxChannels) {
+            ++retries;
+            continue;
+        }
+        out.data.resize(bytes);
+        memcpy(out.data.data(), slot + 1, bytes);
+
+        atomic_thread_fence(memory_order_acquire);
+        if(slot->sequence.load(memory_order_relaxed) == before) {
+            return true;
+        }
+        ++retries;
+    }
+
+    return false;
+}
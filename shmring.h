@@ -0,0 +1,112 @@
+#ifndef SHMRING_H_INCLUDED
+#define SHMRING_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//Electrode frames shared with other local processes (stimulator driver, logger, ...)
+//
+//Layout of the segment :
+//  ShmRingHeader | slot 0 | slot 1 | ... | slot (slotCount - 1)
+//and every slot is a ShmSlotHeader followed by maxWidth * maxHeight * maxChannels bytes
+//(one byte per electrode, or three for the BGR electrodes, B then G then R).
+//
+//Frame n is written in slot n % slotCount. The slot sequence is odd while the publisher writes it
+//(seqlock), so a reader which sees the sequence change during its copy knows it has to retry.
+//The publisher never waits for anybody.
+
+const uint32_t SHM_RING_MAGIC = 0x45594542; //"BEYE"
+const uint32_t SHM_RING_VERSION = 3;
+
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize; //Header of the slot included
+    uint32_t maxWidth;
+    uint32_t maxHeight;
+    std::atomic<uint32_t> lastFrame; //0 before the first frame
+    uint32_t maxChannels;
+    uint32_t reserved[8]; //Up to 64 bytes, so the slots which follow start on a cache line
+};
+
+struct ShmSlotHeader {
+    std::atomic<uint32_t> sequence;
+    uint32_t frame;
+    uint16_t width;
+    uint16_t height;
+    uint16_t channels; //Bytes per electrode
+    uint16_t reserved;
+    uint64_t timestampNs; //monotonicNs() when the frame was published
+};
+
+//Writer side, owned by the simulator
+class ShmPublisher {
+public:
+    ShmPublisher();
+    ~ShmPublisher();
+
+    bool open(std::string const& name, int maxWidth, int maxHeight, int slotCount = 8, int maxChannels = 1);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    //Returns the memory where the next frame must be written (width * channels bytes per row, no padding)
+    //and commit() makes it visible. Nothing is copied between the two.
+    uchar* beginFrame(int width, int height, int channels = 1);
+    void commit();
+
+    //Shortcut for beginFrame() + copy + commit(). The electrode frame is tiny, CV_8UC1 or CV_8UC3.
+    bool publish(cv::Mat const& electrodes);
+
+private:
+    ShmPublisher(ShmPublisher const&);
+    ShmPublisher& operator=(ShmPublisher const&);
+
+    std::string m_name;
+    ShmRingHeader* m_header;
+    size_t m_size;
+    uint32_t m_frame;
+    ShmSlotHeader* m_writing;
+};
+
+struct ShmFrame {
+    uint32_t frame;
+    int width;
+    int height;
+    int channels;
+    uint64_t timestampNs;
+    std::vector<uchar> data;
+};
+
+//Reader side. Read only mapping, any number of readers can attach.
+class ShmSubscriber {
+public:
+    ShmSubscriber();
+    ~ShmSubscriber();
+
+    bool open(std::string const& name);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    //Number of the last published frame (0 if nothing yet)
+    uint32_t lastFrame() const;
+
+    //Copy the last published frame. Returns false if there is none yet,
+    //or if the publisher kept overwriting it during 'maxRetries' attempts.
+    //'retries' is increased each time a copy had to be thrown away.
+    bool readLatest(ShmFrame& out, unsigned int& retries, int maxRetries = 16) const;
+
+private:
+    ShmSubscriber(ShmSubscriber const&);
+    ShmSubscriber& operator=(ShmSubscriber const&);
+
+    ShmRingHeader const* m_header;
+    size_t m_size;
+};
+
+#endif // SHMRING_H_INCLUDED
@@ -0,0 +1,101 @@
+#include "simulator.h"
+
+#include <algorithm>
+
+#include "stages.h"
+#include "timing.h"
+
+using namespace cv;
+using namespace std;
+
+Simulator::Simulator() : m_reverse(true), m_built(false), m_costNs(0) {
+}
+
+void Simulator::setGrid(int electrodes_w, int electrodes_h) {
+    m_settings.electrodes_w = max(electrodes_w, 1);
+    m_settings.electrodes_h = max(electrodes_h, 1);
+}
+
+void Simulator::setAngle(int angle) {
+    m_settings.angle = min(max(angle, 1), 100);
+}
+
+void Simulator::setSmoothing(int alpha) {
+    m_temporal.setAlpha(alpha);
+}
+
+void Simulator::setSpread(double sigma) {
+    bool const enabled(m_spread.enabled());
+    m_spread.configure(sigma);
+    //The stage is only in the pipeline when there is a spread
+    if(m_spread.enabled() != enabled) {
+        m_built = false;
+    }
+}
+
+void Simulator::setReverse(bool reverse) {
+    if(reverse != m_reverse) {
+        m_reverse = reverse;
+        m_built = false;
+    }
+}
+
+Size Simulator::outputSize(int width, int height) const {
+    Rect const crop(reduceRectFixed(width, height, m_settings.angle, m_settings.electrodes_w, m_settings.electrodes_h));
+    //Same clamping as pixeliseImageFixed()
+    return Size(min(m_settings.electrodes_w, crop.width), min(m_settings.electrodes_h, crop.height));
+}
+
+void Simulator::build() {
+    m_pipeline.clear(FRAME_ELECTRODES);
+    m_pipeline.add(new TemporalStage(m_temporal));
+    if(m_spread.enabled()) {
+        m_pipeline.add(new SpreadStage(m_spread, false));
+    }
+    if(m_reverse) {
+        m_pipeline.add(new ReverseStage);
+    }
+    m_pipeline.compile();
+    m_built = true;
+}
+
+bool Simulator::process(FrameView const& frame, ElectrodeView const& electrodes) {
+    if(!validView(frame)) {
+        return false;
+    }
+    Size const grid(outputSize(frame.width, frame.height));
+    if(!electrodes.data || electrodes.width != grid.width || electrodes.height != grid.height
+       || electrodes.stride < static_cast<size_t>(grid.width)) {
+        return false;
+    }
+
+    if(!m_built) {
+        build();
+    }
+    uint64_t const start(monotonicNs());
+
+    //Without the reverse, every step after pixelise is in place : the electrodes go straight to the caller.
+    //With it, they go through a grid of ours and the reverse writes them in the memory of the caller.
+    Mat out(grid.height, grid.width, CV_8UC1, electrodes.data, electrodes.stride);
+    Mat pixelised(out);
+    if(m_reverse) {
+        m_grid.create(grid, CV_8UC1);
+        pixelised = m_grid;
+    }
+    ElectrodeView const target = {pixelised.data, pixelised.cols, pixelised.rows, pixelised.step};
+    Rect const crop(reduceRectFixed(frame.width, frame.height, m_settings.angle, m_settings.electrodes_w, m_settings.electrodes_h));
+    if(!pixeliseView(frame, crop, m_settings.electrodes_w, m_settings.electrodes_h, target)
+       || !m_pipeline.runInto(pixelised, m_settings, out)) {
+        return false;
+    }
+
+    //A last stage which could not write in the memory of the caller : only the grid is copied
+    if(out.data != electrodes.data) {
+        Mat caller(grid.height, grid.width, CV_8UC1, electrodes.data, electrodes.stride);
+        out.copyTo(caller);
+    }
+
+    double const cost(static_cast<double>(monotonicNs() - start));
+    m_costNs = m_costNs == 0 ? cost : m_costNs + (cost - m_costNs) / 8;
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef SIMULATOR_H_INCLUDED
+#define SIMULATOR_H_INCLUDED
+
+#include <opencv2/core.hpp>
+
+#include "fixedpoint.h"
+#include "frameview.h"
+#include "pipeline.h"
+#include "spread.h"
+
+//The simulation for a host process (our stimulator) without any window :
+//grayscale, reduce and pixelise with integers only (pixeliseView()), then smoothing, current spread and reverse
+//as a pipeline of the electrodes. The frame is read in place and the electrodes are written straight
+//into the buffer of the host.
+//One Simulator per thread : the filters keep a state from one frame to the next.
+class Simulator {
+public:
+    Simulator();
+
+    void setGrid(int electrodes_w, int electrodes_h);
+    void setAngle(int angle);
+    //256 : no smoothing, see TemporalFilterFixed
+    void setSmoothing(int alpha);
+    //In electrode pitches, 0 : no spread
+    void setSpread(double sigma);
+    void setReverse(bool reverse);
+
+    //Grid given for a width x height frame : the one set, unless the kept part of the frame has fewer pixels
+    cv::Size outputSize(int width, int height) const;
+
+    //False if a view is invalid or 'electrodes' is not outputSize() of the frame
+    bool process(FrameView const& frame, ElectrodeView const& electrodes);
+
+    //Smoothed time of the last frames
+    double costMs() const { return m_costNs / 1e6; }
+
+private:
+    void build();
+
+    PipelineSettings m_settings;
+    TemporalFilterFixed m_temporal;
+    CurrentSpread m_spread;
+    bool m_reverse;
+
+    Pipeline m_pipeline;
+    bool m_built;
+    cv::Mat m_grid; //Electrodes before the reverse
+    double m_costNs;
+};
+
+#endif // SIMULATOR_H_INCLUDED
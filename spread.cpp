@@ -0,0 +1,124 @@
+#include "spread.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+//Beyond 3 sigma the weights round to nothing, and a phosphene never reaches further than that
+int const maxRadius = 8;
+
+}
+
+CurrentSpread::CurrentSpread(double sigma) : m_sigma(-1), m_radius(0) {
+    m_rows.size = m_cols.size = -1;
+    m_rows.circular = m_cols.circular = false;
+    configure(sigma);
+}
+
+void CurrentSpread::configure(double sigma) {
+    sigma = max(sigma, 0.0);
+    if(sigma == m_sigma) {
+        return;
+    }
+
+    m_sigma = sigma;
+    m_radius = min(static_cast<int>(ceil(3 * sigma)), maxRadius);
+    m_kernel.resize(m_radius + 1);
+    for(int d(0); d <= m_radius; ++d) {
+        m_kernel[d] = exp(-d * d / (2 * sigma * sigma));
+    }
+
+    //The axes are built again on the next apply()
+    m_rows.size = m_cols.size = -1;
+}
+
+void CurrentSpread::buildAxis(Axis& axis, int size, bool circular) const {
+    int const taps(2 * m_radius + 1);
+    axis.size = size;
+    axis.circular = circular;
+    axis.index.assign(size * taps, 0);
+    axis.weight.assign(size * taps, 0);
+
+    for(int i(0); i < size; ++i) {
+        int* index(&axis.index[i * taps]);
+        uint32_t* weight(&axis.weight[i * taps]);
+
+        double total(0);
+        for(int k(-m_radius); k <= m_radius; ++k) {
+            int j(i + k);
+            if(circular) {
+                j = ((j % size) + size) % size;
+            } else if(j < 0 || j >= size) {
+                continue;
+            }
+            total += m_kernel[abs(k)];
+        }
+
+        //Weights in 1/256, the rounding left to the centre so every position sums to exactly 256
+        uint32_t sum(0);
+        for(int k(-m_radius); k <= m_radius; ++k) {
+            int j(i + k);
+            if(circular) {
+                j = ((j % size) + size) % size;
+            } else if(j < 0 || j >= size) {
+                index[k + m_radius] = i;
+                continue;
+            }
+            index[k + m_radius] = j;
+            if(k != 0) {
+                weight[k + m_radius] = static_cast<uint32_t>(m_kernel[abs(k)] / total * 256 + 0.5);
+                sum += weight[k + m_radius];
+            }
+        }
+        weight[m_radius] = 256 - min(sum, 256u);
+    }
+}
+
+void CurrentSpread::apply(Mat& electrodes, bool circularColumns) {
+    if(!enabled() || electrodes.type() != CV_8UC1 || electrodes.empty()) {
+        return;
+    }
+
+    if(m_cols.size != electrodes.cols || m_cols.circular != circularColumns) {
+        buildAxis(m_cols, electrodes.cols, circularColumns);
+    }
+    if(m_rows.size != electrodes.rows) {
+        buildAxis(m_rows, electrodes.rows, false);
+    }
+
+    int const taps(2 * m_radius + 1);
+
+    //Along the rows : 255 * 256 still fits in 16 bits
+    m_horizontal.create(electrodes.rows, electrodes.cols, CV_16UC1);
+    for(int y(0); y < electrodes.rows; ++y) {
+        uchar const* in(electrodes.ptr<uchar>(y));
+        ushort* out(m_horizontal.ptr<ushort>(y));
+        int const* index(m_cols.index.data());
+        uint32_t const* weight(m_cols.weight.data());
+        for(int x(0); x < electrodes.cols; ++x, index += taps, weight += taps) {
+            uint32_t sum(0);
+            for(int t(0); t < taps; ++t) {
+                sum += in[index[t]] * weight[t];
+            }
+            out[x] = sum;
+        }
+    }
+
+    //Along the columns, back to 8 bits with rounding
+    for(int y(0); y < electrodes.rows; ++y) {
+        uchar* out(electrodes.ptr<uchar>(y));
+        int const* index(&m_rows.index[y * taps]);
+        uint32_t const* weight(&m_rows.weight[y * taps]);
+        for(int x(0); x < electrodes.cols; ++x) {
+            uint32_t sum(0);
+            for(int t(0); t < taps; ++t) {
+                sum += m_horizontal.ptr<ushort>(index[t])[x] * weight[t];
+            }
+            out[x] = (sum + 32768) >> 16;
+        }
+    }
+}
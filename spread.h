@@ -0,0 +1,44 @@
+#ifndef SPREAD_H_INCLUDED
+#define SPREAD_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//Current spread : an electrode also stimulates the tissue around it, so neighbouring phosphenes blur
+//together. Gaussian blur of the electrode grid, not of the camera frame, so it costs next to nothing.
+//Separable, integer weights (8 fractional bits), computed once per geometry.
+class CurrentSpread {
+public:
+    //'sigma' in electrode pitches, 0 : no spread
+    explicit CurrentSpread(double sigma = 0);
+
+    //The weights are only rebuilt if sigma changed
+    void configure(double sigma);
+    bool enabled() const { return m_radius > 0; }
+
+    //'circularColumns' : the last column touches the first one (spokes of the foveated layout).
+    //At the borders the current has fewer neighbours to go to, the weights left are scaled back to 1
+    //so the border electrodes keep their brightness.
+    void apply(cv::Mat& electrodes, bool circularColumns = false);
+
+private:
+    //Taps of every position of an axis, 2 * radius + 1 each, the ones out of the grid with a 0 weight
+    struct Axis {
+        int size;
+        bool circular;
+        std::vector<int> index;
+        std::vector<uint32_t> weight;
+    };
+
+    void buildAxis(Axis& axis, int size, bool circular) const;
+
+    double m_sigma;
+    int m_radius;
+    std::vector<double> m_kernel; //Half kernel, m_kernel[d] for a distance d
+    Axis m_rows, m_cols;
+    cv::Mat m_horizontal; //CV_16UC1, after the pass on the rows, 8 fractional bits
+};
+
+#endif // SPREAD_H_INCLUDED
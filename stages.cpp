@@ -0,0 +1,119 @@
+#include "stages.h"
+
+#include <opencv2/opencv.hpp>
+
+#include "gaze.h"
+#include "luma.h"
+#include "pixelisekernels.h"
+#include "processing.h"
+
+using namespace cv;
+using namespace std;
+
+bool GrayStage::run(Mat const& in, Mat& out, PipelineSettings const&) {
+    if(m_fixed) {
+        convertImageToGrayScaleFixed(in, out);
+    } else {
+        cvtColor(in, out, COLOR_BGR2GRAY);
+    }
+    return !out.empty();
+}
+
+bool ReduceStage::run(Mat const& in, Mat& out, PipelineSettings const& settings) {
+    Rect crop;
+    if(settings.plan) {
+        crop = settings.plan->crop;
+    } else if(m_fixed) {
+        crop = reduceRectFixed(in.cols, in.rows, settings.angle, settings.electrodes_w, settings.electrodes_h);
+    } else {
+        crop = reduceRect(in.cols, in.rows, settings.angle, (double)settings.electrodes_h / (double)settings.electrodes_w);
+    }
+    out = Mat(in, crop);
+    return true;
+}
+
+bool RawLumaStage::run(Mat const& in, Mat& out, PipelineSettings const& settings) {
+    Size const size(settings.rawSize);
+    Rect crop(settings.plan ? settings.plan->crop : reduceRectFixed(size.width, size.height, settings.angle, settings.electrodes_w, settings.electrodes_h));
+    return extractLuma(in, settings.rawFourcc, size, crop, out) != LUMA_UNAVAILABLE;
+}
+
+bool PixeliseStage::run(Mat const& in, Mat& out, PipelineSettings const& settings) {
+    if(settings.plan) {
+        sampleElectrodes(in, *settings.plan, out);
+    } else if(m_defects && !m_defects->empty() && in.channels() == 1) {
+        m_defects->pixelise(in, settings.electrodes_w, settings.electrodes_h, out);
+    } else if(m_fixed) {
+        pixeliseImageFixed(in, settings.electrodes_w, settings.electrodes_h, out);
+    } else {
+        pixeliseImageDispatch(in, settings.electrodes_w, settings.electrodes_h, out);
+    }
+    return !out.empty();
+}
+
+bool LumaStage::run(Mat const& in, Mat& out, PipelineSettings const&) {
+    if(m_fixed) {
+        convertImageToGrayScaleFixed(in, out);
+    } else {
+        cvtColor(in, out, COLOR_BGR2GRAY);
+    }
+    return !out.empty();
+}
+
+bool FoveatedStage::run(Mat const& in, Mat& out, PipelineSettings const& settings) {
+    m_sampler.configure(in.size(), settings.electrodes_h, settings.electrodes_w);
+    m_sampler.sample(in, out);
+    return !out.empty();
+}
+
+bool EdgesStage::run(Mat const& in, Mat& out, PipelineSettings const& settings) {
+    pixeliseEdges(in, settings.electrodes_w, settings.electrodes_h, m_mode, settings.edgeGain, out);
+    return !out.empty();
+}
+
+bool ContrastStage::run(Mat const&, Mat& out, PipelineSettings const&) {
+    if(m_defects && !m_defects->empty()) {
+        m_defects->liveMask(out.cols, out.rows, m_live);
+        m_contrast.apply(out, m_live);
+        return true;
+    }
+    m_contrast.apply(out);
+    return true;
+}
+
+bool DefectStage::run(Mat const&, Mat& out, PipelineSettings const&) {
+    m_defects.apply(out);
+    return true;
+}
+
+bool TemporalStage::run(Mat const&, Mat& out, PipelineSettings const&) {
+    m_filter.apply(out);
+    return true;
+}
+
+bool SpreadStage::run(Mat const&, Mat& out, PipelineSettings const&) {
+    m_spread.apply(out, m_circular);
+    return true;
+}
+
+bool ReverseStage::run(Mat const& in, Mat& out, PipelineSettings const&) {
+    if(m_foveated) {
+        out = in;
+        m_foveated->reverse(out);
+    } else {
+        //Both axes flipped, as reverseImage() does, but in the buffer of the stage
+        flip(in, out, -1);
+    }
+    return true;
+}
+
+bool QuantizeStage::run(Mat const& in, Mat& out, PipelineSettings const&) {
+    m_quantizer.quantize(in, m_levels, m_dither);
+    m_quantizer.toGray(m_levels, out);
+    return true;
+}
+
+bool ExtendStage::run(Mat const& in, Mat& out, PipelineSettings const& settings) {
+    extendImage(in, settings.zoom, out);
+    return true;
+}
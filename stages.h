@@ -0,0 +1,229 @@
+#ifndef STAGES_H_INCLUDED
+#define STAGES_H_INCLUDED
+
+#include <opencv2/core.hpp>
+
+#include "contrast.h"
+#include "defects.h"
+#include "edges.h"
+#include "fixedpoint.h"
+#include "foveated.h"
+#include "pipeline.h"
+#include "quantize.h"
+#include "spread.h"
+
+//The steps of the simulation as pipeline stages.
+//The stages keep a reference to the objects they use, which stay owned and configured by the caller.
+
+//2 - Convert to grayscale, with cvtColor() or integers only
+class GrayStage : public Stage {
+public:
+    explicit GrayStage(bool fixed) : m_fixed(fixed) {}
+
+    std::string name() const { return "grayscale"; }
+    bool accepts(FrameKind input) const { return input == FRAME_BGR; }
+    FrameKind output(FrameKind) const { return FRAME_GRAY; }
+    bool perPixel() const { return true; }
+    bool fixedLuma() const { return m_fixed; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    bool m_fixed;
+};
+
+//3 - Keep the part of the picture the electrodes see : the crop of the gaze plan if there is one,
+//the centred one of reduceImage() (or reduceRectFixed()) otherwise
+class ReduceStage : public Stage {
+public:
+    explicit ReduceStage(bool fixed) : m_fixed(fixed) {}
+
+    std::string name() const { return "reduce"; }
+    bool accepts(FrameKind input) const { return input == FRAME_BGR || input == FRAME_GRAY; }
+    FrameKind output(FrameKind input) const { return input; }
+    StageMemory memory() const { return STAGE_VIEW; }
+    bool isCrop() const { return true; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    bool m_fixed;
+};
+
+//2 and 3 from the Y of the camera buffer, only the kept part is read.
+//A view of the Y plane when the buffer has one, a copy of the Y of the packed formats otherwise.
+class RawLumaStage : public Stage {
+public:
+    std::string name() const { return "reduce"; }
+    bool accepts(FrameKind input) const { return input == FRAME_RAW; }
+    FrameKind output(FrameKind) const { return FRAME_GRAY; }
+    StageMemory memory() const { return STAGE_VIEW; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+};
+
+//4 - Average of every electrode of the grid (or of the gaze plan).
+//With a defect map, the dead and stuck electrodes are not summed.
+//BGR gives the average of every channel, in the same pass (the defect map is then left to DefectStage).
+class PixeliseStage : public Stage {
+public:
+    PixeliseStage(bool fixed, DefectMap* defects = nullptr) : m_fixed(fixed), m_defects(defects) {}
+
+    std::string name() const { return "pixelise"; }
+    bool accepts(FrameKind input) const { return input == FRAME_GRAY || input == FRAME_BGR; }
+    FrameKind output(FrameKind input) const { return input == FRAME_BGR ? FRAME_BGR_ELECTRODES : FRAME_ELECTRODES; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    bool m_fixed;
+    DefectMap* m_defects;
+};
+
+//What the uniform grid does with the colours ('k')
+enum ColourMode {
+    COLOUR_GRAY,      //Grayscale picture, then pixelise
+    COLOUR_WEIGHTED,  //Pixelise BGR, then the gray of the electrodes (LumaStage)
+    COLOUR_ELECTRODES //Pixelise BGR and keep it to the output, for the arrays with a channel per colour
+};
+
+//Gray of the BGR electrodes : the weighting done on the grid instead of on every pixel of the crop.
+//Not bit exact with grayscale then pixelise, the mean of the grays being rounded once less.
+class LumaStage : public Stage {
+public:
+    explicit LumaStage(bool fixed) : m_fixed(fixed) {}
+
+    std::string name() const { return "luma"; }
+    bool accepts(FrameKind input) const { return input == FRAME_BGR_ELECTRODES; }
+    FrameKind output(FrameKind) const { return FRAME_ELECTRODES; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    bool m_fixed;
+};
+
+//4 - electrodes_h rings of electrodes_w electrodes
+class FoveatedStage : public Stage {
+public:
+    explicit FoveatedStage(FoveatedSampler& sampler) : m_sampler(sampler) {}
+
+    std::string name() const { return "pixelise"; }
+    bool accepts(FrameKind input) const { return input == FRAME_GRAY; }
+    FrameKind output(FrameKind) const { return FRAME_ELECTRODES; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    FoveatedSampler& m_sampler;
+};
+
+//4 - Edge strength of the blocks instead of their gray. Takes BGR too, converted row by row.
+class EdgesStage : public Stage {
+public:
+    explicit EdgesStage(EdgeMode mode) : m_mode(mode) {}
+
+    std::string name() const { return "edges"; }
+    bool accepts(FrameKind input) const { return input == FRAME_GRAY || input == FRAME_BGR; }
+    FrameKind output(FrameKind) const { return FRAME_ELECTRODES; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    EdgeMode m_mode;
+};
+
+//With a defect map, only the electrodes which stimulate are in the statistics
+class ContrastStage : public Stage {
+public:
+    explicit ContrastStage(AdaptiveContrast& contrast, DefectMap* defects = nullptr) : m_contrast(contrast), m_defects(defects) {}
+
+    std::string name() const { return "contrast"; }
+    bool accepts(FrameKind input) const { return input == FRAME_ELECTRODES; }
+    FrameKind output(FrameKind) const { return FRAME_ELECTRODES; }
+    StageMemory memory() const { return STAGE_IN_PLACE; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    AdaptiveContrast& m_contrast;
+    DefectMap* m_defects;
+    cv::Mat m_live;
+};
+
+class DefectStage : public Stage {
+public:
+    explicit DefectStage(DefectMap& defects) : m_defects(defects) {}
+
+    std::string name() const { return "defects"; }
+    bool accepts(FrameKind input) const { return input == FRAME_ELECTRODES || input == FRAME_BGR_ELECTRODES; }
+    FrameKind output(FrameKind input) const { return input; }
+    StageMemory memory() const { return STAGE_IN_PLACE; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    DefectMap& m_defects;
+};
+
+class TemporalStage : public Stage {
+public:
+    explicit TemporalStage(TemporalFilterFixed& filter) : m_filter(filter) {}
+
+    std::string name() const { return "smoothing"; }
+    bool accepts(FrameKind input) const { return input == FRAME_ELECTRODES || input == FRAME_BGR_ELECTRODES; }
+    FrameKind output(FrameKind input) const { return input; }
+    StageMemory memory() const { return STAGE_IN_PLACE; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    TemporalFilterFixed& m_filter;
+};
+
+class SpreadStage : public Stage {
+public:
+    SpreadStage(CurrentSpread& spread, bool circularColumns) : m_spread(spread), m_circular(circularColumns) {}
+
+    std::string name() const { return "spread"; }
+    bool accepts(FrameKind input) const { return input == FRAME_ELECTRODES; }
+    FrameKind output(FrameKind) const { return FRAME_ELECTRODES; }
+    StageMemory memory() const { return STAGE_IN_PLACE; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    CurrentSpread& m_spread;
+    bool m_circular;
+};
+
+//5 - Reverse the picture : half a turn of the grid, or of the rings with a foveated sampler
+class ReverseStage : public Stage {
+public:
+    explicit ReverseStage(FoveatedSampler const* foveated = nullptr) : m_foveated(foveated) {}
+
+    std::string name() const { return "reverse"; }
+    bool accepts(FrameKind input) const { return input == FRAME_ELECTRODES || (input == FRAME_BGR_ELECTRODES && !m_foveated); }
+    FrameKind output(FrameKind input) const { return input; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    FoveatedSampler const* m_foveated;
+};
+
+//6 - Round to the current levels of the electrodes. The levels go in 'levels', the output is their gray.
+//BGR electrodes get a level per channel.
+class QuantizeStage : public Stage {
+public:
+    QuantizeStage(Quantizer const& quantizer, DitherMode dither, cv::Mat& levels) : m_quantizer(quantizer), m_dither(dither), m_levels(levels) {}
+
+    std::string name() const { return "quantize"; }
+    bool accepts(FrameKind input) const { return input == FRAME_ELECTRODES || input == FRAME_BGR_ELECTRODES; }
+    FrameKind output(FrameKind input) const { return input; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+
+private:
+    Quantizer const& m_quantizer;
+    DitherMode m_dither;
+    cv::Mat& m_levels;
+};
+
+//Make the electrodes big enough to be seen, 'zoom' pixels each
+class ExtendStage : public Stage {
+public:
+    std::string name() const { return "extend"; }
+    bool accepts(FrameKind input) const { return input == FRAME_ELECTRODES; }
+    FrameKind output(FrameKind) const { return FRAME_GRAY; }
+    bool run(cv::Mat const& in, cv::Mat& out, PipelineSettings const& settings);
+};
+
+#endif // STAGES_H_INCLUDED
@@ -0,0 +1,181 @@
+#include "streaming.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+#include <opencv2/opencv.hpp>
+
+#include "fixedpoint.h"
+#include "processing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+//Next number of a PNM header, skipping the spaces and the comments
+bool readHeaderNumber(istream& file, int64_t& value) {
+    int c(file.get());
+    while(file && (isspace(c) || c == '#')) {
+        if(c == '#') {
+            while(file && c != '\n') {
+                c = file.get();
+            }
+        }
+        c = file.get();
+    }
+    if(!file || !isdigit(c)) {
+        return false;
+    }
+
+    value = 0;
+    while(file && isdigit(c)) {
+        value = value * 10 + (c - '0');
+        c = file.get();
+    }
+    //The single space after the last number is part of the header
+    return static_cast<bool>(file);
+}
+
+bool cropInside(Rect const& crop, int cols, int rows) {
+    return crop.width > 0 && crop.height > 0 && (crop & Rect(0, 0, cols, rows)) == crop;
+}
+
+enum PnmResult {
+    PNM_REDUCED,
+    PNM_UNKNOWN, //Not a binary PGM or PPM, for imread()
+    PNM_FAILED   //A PNM it was, the error is printed
+};
+
+PnmResult reducePnm(ifstream& file, string const& filename, int angle, int electrodes_w, int electrodes_h, Mat& electrodes) {
+    char magic[2] = {0, 0};
+    file.read(magic, 2);
+    int channels(magic[0] == 'P' && magic[1] == '5' ? 1 : magic[0] == 'P' && magic[1] == '6' ? 3 : 0);
+    int64_t cols(0), rows(0), maxValue(0);
+    if(channels == 0 || !readHeaderNumber(file, cols) || !readHeaderNumber(file, rows) || !readHeaderNumber(file, maxValue)) {
+        return PNM_UNKNOWN;
+    }
+    //Too big for memory is why it is read row by row : imread() would not do better
+    if(maxValue > 255 || cols <= 0 || rows <= 0 || cols > INT32_MAX / 100 || rows > INT32_MAX) {
+        cout << filename << " : only 8 bits pictures under 21 million pixels wide are supported" << endl;
+        return PNM_FAILED;
+    }
+
+    StreamingReducer reducer(static_cast<int>(cols), static_cast<int>(rows), angle, electrodes_w, electrodes_h);
+    Rect const crop(reducer.crop());
+    if(!reducer.valid()) {
+        cout << filename << " : " << electrodes_w << " x " << electrodes_h << " electrodes on " << angle << " % give no crop in the picture" << endl;
+        return PNM_FAILED;
+    }
+    streamoff const start(file.tellg()),
+                    rowBytes(static_cast<streamoff>(cols) * channels);
+
+    //One row of the crop at a time, read straight from its place in the file
+    Mat line(1, crop.width, channels == 1 ? CV_8UC1 : CV_8UC3), gray(1, crop.width, CV_8UC1);
+    for(int y(crop.y); !reducer.done(); ++y) {
+        file.seekg(start + y * rowBytes + crop.x * channels);
+        file.read(reinterpret_cast<char*>(line.ptr<uchar>(0)), static_cast<streamsize>(crop.width) * channels);
+        if(!file) {
+            cout << filename << " : truncated at row " << y << endl;
+            return PNM_FAILED;
+        }
+
+        if(channels == 3) {
+            //PPM is RGB, the conversion expects BGR
+            uchar* p(line.ptr<uchar>(0));
+            for(int x(0); x < crop.width; ++x, p += 3) {
+                swap(p[0], p[2]);
+            }
+            convertImageToGrayScaleFixed(line, gray);
+            reducer.addRow(gray.ptr<uchar>(0));
+        } else {
+            reducer.addRow(line.ptr<uchar>(0));
+        }
+    }
+
+    electrodes = reducer.electrodes();
+    cout << filename << " : " << cols << " x " << rows << ", " << crop.width << " x " << crop.height << " read row by row" << endl;
+    return PNM_REDUCED;
+}
+
+}
+
+StreamingReducer::StreamingReducer(int cols, int rows, int angle, int electrodes_w, int electrodes_h)
+    : m_crop(reduceRectFixed(cols, rows, angle, electrodes_w, electrodes_h)), m_valid(cropInside(m_crop, cols, rows)), m_row(0) {
+    if(!m_valid) {
+        //done() at once, and electrodes() empty rather than never written
+        m_blockW = m_blockH = 1;
+        m_usedRows = 0;
+        return;
+    }
+
+    //Same rules as pixeliseImage()
+    electrodes_w = min(max(electrodes_w, 1), max(m_crop.width, 1));
+    electrodes_h = min(max(electrodes_h, 1), max(m_crop.height, 1));
+    m_blockW = m_crop.width / electrodes_w;
+    m_blockH = m_crop.height / electrodes_h;
+    m_usedRows = m_blockH * electrodes_h;
+    m_sums.assign(electrodes_w, 0);
+    m_electrodes.create(electrodes_h, electrodes_w, CV_8UC1);
+}
+
+void StreamingReducer::addRow(uchar const* gray) {
+    if(done()) {
+        return;
+    }
+
+    uchar const* p(gray);
+    for(size_t bx(0); bx < m_sums.size(); ++bx, p += m_blockW) {
+        uint64_t sum(0);
+        for(int x(0); x < m_blockW; ++x) {
+            sum += p[x];
+        }
+        m_sums[bx] += sum;
+    }
+    ++m_row;
+
+    //Last row of a block : its electrodes are complete.
+    //The blocks can be much bigger than the 11 million pixels of BlockDivisor here, a true division per electrode it is.
+    if(m_row % m_blockH == 0) {
+        uint64_t const pixels(static_cast<uint64_t>(m_blockW) * m_blockH);
+        uchar* out(m_electrodes.ptr<uchar>(m_row / m_blockH - 1));
+        for(size_t bx(0); bx < m_sums.size(); ++bx) {
+            out[bx] = static_cast<uchar>(m_sums[bx] / pixels);
+            m_sums[bx] = 0;
+        }
+    }
+}
+
+bool reduceImageFile(string const& filename, int angle, int electrodes_w, int electrodes_h, Mat& electrodes) {
+    ifstream file(filename.c_str(), ios::binary);
+    if(!file) {
+        cout << "Could not open or find image : " << filename << endl;
+        return false;
+    }
+    //The size checks below only hold up to 100 %, and more would be a crop bigger than the picture
+    if(angle < 0 || angle > 100) {
+        cout << filename << " : angle " << angle << " % out of 0 to 100" << endl;
+        return false;
+    }
+    PnmResult const pnm(reducePnm(file, filename, angle, electrodes_w, electrodes_h, electrodes));
+    if(pnm != PNM_UNKNOWN) {
+        return pnm == PNM_REDUCED;
+    }
+    file.close();
+
+    //Any other format, decoded in one go
+    cout << filename << " : not a binary PGM or PPM, decoded whole" << endl;
+    Mat img;
+    if(!loadImage(img, filename)) {
+        return false;
+    }
+    if(!cropInside(reduceRectFixed(img.cols, img.rows, angle, electrodes_w, electrodes_h), img.cols, img.rows)) {
+        cout << filename << " : " << electrodes_w << " x " << electrodes_h << " electrodes on " << angle << " % give no crop in the picture" << endl;
+        return false;
+    }
+    runFixedPointPipeline(img, angle, electrodes_w, electrodes_h);
+    electrodes = img;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef STREAMING_H_INCLUDED
+#define STREAMING_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//Pictures too big to be decoded in memory (panoramas, microscope slides) : the rows go one after the other
+//into the reduction, so only one row and one row of sums are kept, whatever the size of the picture.
+
+//Reduce then pixelise a cols x rows picture given row after row, from the top.
+//Same crop as reduceImageFixed() and same electrodes as pixeliseImage().
+class StreamingReducer {
+public:
+    StreamingReducer(int cols, int rows, int angle, int electrodes_w, int electrodes_h);
+
+    //Part of the picture which is used : the rows out of it do not have to be read
+    cv::Rect crop() const { return m_crop; }
+    //False when the angle or the grid give a crop out of the picture (angle over 100, negative grid) : nothing is reduced then
+    bool valid() const { return m_valid; }
+
+    //Next row of the crop, crop().width gray values
+    void addRow(uchar const* gray);
+    bool done() const { return m_row >= m_usedRows; }
+
+    //CV_8UC1, electrodes_h x electrodes_w, complete once done()
+    cv::Mat const& electrodes() const { return m_electrodes; }
+
+private:
+    cv::Rect m_crop;
+    bool m_valid;
+    int m_blockW, m_blockH;
+    int m_usedRows; //The last rows of the crop which do not fill a block are left out, as in pixeliseImage()
+    int m_row;
+    std::vector<uint64_t> m_sums;
+    cv::Mat m_electrodes;
+};
+
+//Binary PGM (P5) and PPM (P6) are read row by row, only the crop being read from the disk.
+//The other formats are decoded whole by imread(), convert them to PGM first for the big ones.
+//A PGM or PPM which cannot be read row by row (too wide, more than 8 bits, truncated) is an error, never imread().
+//So is an angle out of 0 to 100 or a grid whose crop is not in the picture, whatever the format.
+bool reduceImageFile(std::string const& filename, int angle, int electrodes_w, int electrodes_h, cv::Mat& electrodes);
+
+#endif // STREAMING_H_INCLUDED
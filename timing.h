@@ -0,0 +1,15 @@
+#ifndef TIMING_H_INCLUDED
+#define TIMING_H_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+
+//Monotonic time in nanoseconds.
+//steady_clock is CLOCK_MONOTONIC on Linux, so two processes on the same machine
+//can compare their timestamps (used to measure latency between the simulator and its readers)
+inline uint64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // TIMING_H_INCLUDED
@@ -0,0 +1,269 @@
+//Stand-in for the stimulator : receives the electrode frames sent over UDP by the simulator.
+//
+//  UdpReceiver [port]              print the frames received, lost and the latency every second
+//  UdpReceiver --selftest [n]      send n synthetic frames to itself on localhost and report the same
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "timing.h"
+#include "udpstream.h"
+
+using namespace std;
+
+#ifndef _WIN32
+
+namespace {
+
+const int BATCH_SIZE = 64;
+const int MAX_DATAGRAM = 65536;
+const int PENDING_FRAMES = 4; //Frames being reassembled at the same time
+
+struct PendingFrame {
+    uint32_t frame;
+    uint16_t fragmentCount;
+    uint16_t received;
+    uint64_t timestampNs;
+    vector<bool> fragments;
+    vector<uint8_t> data;
+};
+
+class Statistics {
+public:
+    Statistics() : m_highest(0), m_completed(0), m_lost(0), m_duplicates(0), m_invalid(0) {
+    }
+
+    //Returns the pending frame this datagram belongs to, or null if it is too old
+    PendingFrame* pendingFor(UdpFrameHeader const& header) {
+        if(m_highest != 0 && header.frame + PENDING_FRAMES <= m_highest) {
+            return nullptr;
+        }
+
+        PendingFrame& pending(m_pending[header.frame % PENDING_FRAMES]);
+        if(pending.frame != header.frame) {
+            //An unfinished frame is thrown away to make room
+            if(pending.frame != 0 && pending.received < pending.fragmentCount) {
+                ++m_lost;
+            }
+
+            pending.frame = header.frame;
+            pending.fragmentCount = header.fragmentCount;
+            pending.received = 0;
+            pending.timestampNs = header.timestampNs;
+            pending.fragments.assign(header.fragmentCount, false);
+            pending.data.resize(udpFrameBytes(header.width, header.height, header.bits, header.channels));
+        }
+
+        //Frames never seen at all are lost too
+        if(header.frame > m_highest) {
+            if(m_highest != 0 && header.frame > m_highest + 1) {
+                m_lost += header.frame - m_highest - 1;
+            }
+            m_highest = header.frame;
+        }
+
+        return &pending;
+    }
+
+    void onDatagram(uint8_t const* buffer, size_t size) {
+        UdpFrameHeader header;
+        if(!readUdpFrameHeader(buffer, size, header)) {
+            ++m_invalid;
+            return;
+        }
+
+        PendingFrame* pending(pendingFor(header));
+        if(pending == nullptr || header.fragmentCount != pending->fragmentCount
+           || header.offset + header.length > pending->data.size()) {
+            ++m_invalid;
+            return;
+        }
+        if(pending->fragments[header.fragment]) {
+            ++m_duplicates;
+            return;
+        }
+
+        memcpy(&pending->data[header.offset], buffer + UDP_FRAME_HEADER_SIZE, header.length);
+        pending->fragments[header.fragment] = true;
+        if(++pending->received == pending->fragmentCount) {
+            m_latencies.push_back(monotonicNs() - pending->timestampNs);
+            ++m_completed;
+        }
+    }
+
+    void print() {
+        cout << m_completed << " frames, " << m_lost << " lost";
+        if(!m_latencies.empty()) {
+            sort(m_latencies.begin(), m_latencies.end());
+            cout << ", latency (us) min " << m_latencies.front() / 1000
+                 << " median " << m_latencies[m_latencies.size() / 2] / 1000
+                 << " p99 " << m_latencies[m_latencies.size() * 99 / 100] / 1000
+                 << " max " << m_latencies.back() / 1000;
+        }
+        cout << ", " << m_duplicates << " duplicated, " << m_invalid << " invalid datagrams" << endl;
+
+        m_latencies.clear();
+        m_completed = 0;
+        m_lost = 0;
+        m_duplicates = 0;
+        m_invalid = 0;
+    }
+
+    unsigned int completed() const { return m_completed; }
+    uint32_t highest() const { return m_highest; }
+
+private:
+    PendingFrame m_pending[PENDING_FRAMES] = {};
+    uint32_t m_highest;
+    unsigned int m_completed, m_lost, m_duplicates, m_invalid;
+    vector<uint64_t> m_latencies;
+};
+
+int openSocket(int port) {
+    int fd(socket(AF_INET, SOCK_DGRAM, 0));
+    if(fd < 0) {
+        cout << "Could not create the socket" << endl;
+        return -1;
+    }
+
+    //Bigger receive buffer, the simulator sends a whole frame in one burst
+    int bufferSize(4 << 20);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        cout << "Could not listen on port " << port << endl;
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+//Receive until 'stop' is true, and print the statistics every second if 'report' is true
+void receive(int fd, Statistics& statistics, atomic<bool> const& stop, bool report) {
+    vector<uint8_t> buffers(static_cast<size_t>(BATCH_SIZE) * MAX_DATAGRAM);
+    iovec iov[BATCH_SIZE];
+#ifdef __linux__
+    mmsghdr messages[BATCH_SIZE];
+    memset(messages, 0, sizeof(messages));
+    for(int i(0); i < BATCH_SIZE; ++i) {
+        iov[i].iov_base = &buffers[static_cast<size_t>(i) * MAX_DATAGRAM];
+        iov[i].iov_len = MAX_DATAGRAM;
+        messages[i].msg_hdr.msg_iov = &iov[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    uint64_t nextReport(monotonicNs() + 1000000000ull);
+    while(!stop) {
+        pollfd waiting = {fd, POLLIN, 0};
+        if(poll(&waiting, 1, 100) > 0) {
+#ifdef __linux__
+            int count(recvmmsg(fd, messages, BATCH_SIZE, MSG_DONTWAIT, nullptr));
+            for(int i(0); i < count; ++i) {
+                statistics.onDatagram(static_cast<uint8_t*>(iov[i].iov_base), messages[i].msg_len);
+            }
+#else
+            ssize_t size(recv(fd, buffers.data(), MAX_DATAGRAM, MSG_DONTWAIT));
+            if(size > 0) {
+                statistics.onDatagram(buffers.data(), size);
+            }
+#endif
+        }
+
+        if(report && monotonicNs() >= nextReport) {
+            statistics.print();
+            nextReport += 1000000000ull;
+        }
+    }
+}
+
+int selfTest(int frames) {
+    int port(UDP_DEFAULT_PORT + 1);
+    int fd(openSocket(port));
+    if(fd < 0) {
+        return 1;
+    }
+
+    //A 100 x 60 grid takes 5 datagrams, like the biggest implants
+    cv::Mat electrodes(60, 100, CV_8UC1, cv::Scalar(0));
+    UdpStreamer streamer;
+    if(!streamer.open("127.0.0.1", port, 100, 60)) {
+        close(fd);
+        return 1;
+    }
+
+    Statistics statistics;
+    atomic<bool> stop(false);
+    thread receiver([&]() { receive(fd, statistics, stop, false); });
+
+    for(int i(0); i < frames; ++i) {
+        electrodes.ptr<uchar>(i % 60)[i % 100] = i;
+        streamer.send(electrodes);
+        this_thread::sleep_for(chrono::microseconds(500));
+    }
+    this_thread::sleep_for(chrono::milliseconds(200));
+    stop = true;
+    receiver.join();
+    close(fd);
+
+    cout << "Self test : " << frames << " frames sent, " << streamer.datagramsDropped() << " datagrams dropped by the sender\n";
+    statistics.print();
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int port(UDP_DEFAULT_PORT);
+
+    for(int i(1); i < argc; ++i) {
+        string arg(argv[i]);
+        if(arg == "--selftest") {
+            return selfTest(i + 1 < argc ? max(1, atoi(argv[i + 1])) : 10000);
+        } else {
+            port = atoi(arg.c_str());
+        }
+    }
+
+    int fd(openSocket(port));
+    if(fd < 0) {
+        return 1;
+    }
+    cout << "Listening on 127.0.0.1:" << port << endl;
+
+    Statistics statistics;
+    atomic<bool> stop(false);
+    receive(fd, statistics, stop, true);
+    close(fd);
+    return 0;
+}
+
+#else
+
+int main() {
+    cout << "UdpReceiver needs a POSIX system" << endl;
+    return 1;
+}
+
+#endif
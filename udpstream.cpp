@@ -0,0 +1,286 @@
+#include "udpstream.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "timing.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+void put16(uint8_t* out, uint16_t value) {
+    out[0] = value >> 8;
+    out[1] = value;
+}
+
+void put32(uint8_t* out, uint32_t value) {
+    put16(out, value >> 16);
+    put16(out + 2, value);
+}
+
+void put64(uint8_t* out, uint64_t value) {
+    put32(out, value >> 32);
+    put32(out + 4, value);
+}
+
+uint16_t get16(uint8_t const* in) {
+    return (in[0] << 8) | in[1];
+}
+
+uint32_t get32(uint8_t const* in) {
+    return (static_cast<uint32_t>(get16(in)) << 16) | get16(in + 2);
+}
+
+uint64_t get64(uint8_t const* in) {
+    return (static_cast<uint64_t>(get32(in)) << 32) | get32(in + 4);
+}
+
+}
+
+void writeUdpFrameHeader(UdpFrameHeader const& header, uint8_t* out) {
+    put32(out, UDP_FRAME_MAGIC);
+    put32(out + 4, header.frame);
+    put64(out + 8, header.timestampNs);
+    put16(out + 16, header.width);
+    put16(out + 18, header.height);
+    put16(out + 20, header.fragment);
+    put16(out + 22, header.fragmentCount);
+    put32(out + 24, header.offset);
+    put16(out + 28, header.length);
+    out[30] = header.bits == 8 ? 0 : header.bits;
+    out[31] = header.channels == 1 ? 0 : header.channels;
+}
+
+bool readUdpFrameHeader(uint8_t const* in, size_t size, UdpFrameHeader& header) {
+    if(size < UDP_FRAME_HEADER_SIZE || get32(in) != UDP_FRAME_MAGIC) {
+        return false;
+    }
+
+    header.frame = get32(in + 4);
+    header.timestampNs = get64(in + 8);
+    header.width = get16(in + 16);
+    header.height = get16(in + 18);
+    header.fragment = get16(in + 20);
+    header.fragmentCount = get16(in + 22);
+    header.offset = get32(in + 24);
+    header.length = get16(in + 28);
+    header.bits = in[30] == 0 ? 8 : in[30];
+    header.channels = in[31] == 0 ? 1 : in[31];
+
+    return header.length == size - UDP_FRAME_HEADER_SIZE
+        && header.fragment < header.fragmentCount
+        && (header.bits == 1 || header.bits == 2 || header.bits == 4 || header.bits == 8)
+        && (header.channels == 1 || header.channels == 3)
+        && static_cast<size_t>(header.offset) + header.length <= udpFrameBytes(header.width, header.height, header.bits, header.channels);
+}
+
+size_t udpFrameBytes(int width, int height, int bits, int channels) {
+    return (static_cast<size_t>(width) * height * channels * bits + 7) / 8;
+}
+
+#ifndef _WIN32
+
+struct UdpStreamer::Batch {
+    vector<iovec> iov; //Two per datagram : header, then electrodes
+#ifdef __linux__
+    vector<mmsghdr> messages;
+#else
+    vector<msghdr> messages;
+#endif
+};
+
+UdpStreamer::UdpStreamer() : m_socket(-1), m_maxWidth(0), m_maxHeight(0), m_payloadSize(0), m_maxChannels(0),
+                             m_frame(0), m_framesSent(0), m_dropped(0) {
+}
+
+UdpStreamer::~UdpStreamer() {
+    close();
+}
+
+bool UdpStreamer::open(string const& host, int port, int maxWidth, int maxHeight, int payloadSize, int maxChannels) {
+    close();
+
+    if(maxWidth <= 0 || maxHeight <= 0 || maxWidth > 0xFFFF || maxHeight > 0xFFFF
+       || payloadSize <= 0 || payloadSize > 0xFFFF - static_cast<int>(UDP_FRAME_HEADER_SIZE)
+       || (maxChannels != 1 && maxChannels != 3)) {
+        cout << "UDP : invalid geometry" << endl;
+        return false;
+    }
+
+    sockaddr_in destination;
+    memset(&destination, 0, sizeof(destination));
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(port);
+    if(inet_pton(AF_INET, host.c_str(), &destination.sin_addr) != 1) {
+        cout << "UDP : invalid address " << host << endl;
+        return false;
+    }
+
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if(m_socket < 0) {
+        cout << "UDP : could not create the socket" << endl;
+        return false;
+    }
+
+    //Connected socket : the datagrams do not need an address each
+    if(connect(m_socket, reinterpret_cast<sockaddr*>(&destination), sizeof(destination)) != 0) {
+        cout << "UDP : could not reach " << host << ":" << port << endl;
+        close();
+        return false;
+    }
+
+    m_maxWidth = maxWidth;
+    m_maxHeight = maxHeight;
+    m_payloadSize = payloadSize;
+    m_maxChannels = maxChannels;
+
+    size_t const maxBytes(static_cast<size_t>(maxWidth) * maxHeight * maxChannels);
+    size_t maxFragments((maxBytes + payloadSize - 1) / payloadSize);
+    m_headers.assign(maxFragments * UDP_FRAME_HEADER_SIZE, 0);
+    m_staging.assign(maxBytes, 0);
+
+    m_batch.reset(new Batch);
+    m_batch->iov.resize(maxFragments * 2);
+    m_batch->messages.resize(maxFragments);
+    memset(m_batch->messages.data(), 0, m_batch->messages.size() * sizeof(m_batch->messages[0]));
+    for(size_t i(0); i < maxFragments; ++i) {
+        m_batch->iov[2 * i].iov_base = &m_headers[i * UDP_FRAME_HEADER_SIZE];
+        m_batch->iov[2 * i].iov_len = UDP_FRAME_HEADER_SIZE;
+#ifdef __linux__
+        msghdr& message(m_batch->messages[i].msg_hdr);
+#else
+        msghdr& message(m_batch->messages[i]);
+#endif
+        message.msg_iov = &m_batch->iov[2 * i];
+        message.msg_iovlen = 2;
+    }
+
+    return true;
+}
+
+void UdpStreamer::close() {
+    if(m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+}
+
+bool UdpStreamer::send(Mat const& electrodes) {
+    if(m_socket < 0 || (electrodes.type() != CV_8UC1 && electrodes.type() != CV_8UC3) || electrodes.empty()
+       || electrodes.cols > m_maxWidth || electrodes.rows > m_maxHeight || electrodes.channels() > m_maxChannels) {
+        return false;
+    }
+
+    //The datagrams point straight into the frame when it is continuous
+    uint8_t const* data(electrodes.ptr<uchar>(0));
+    if(!electrodes.isContinuous()) {
+        size_t const row(electrodes.cols * electrodes.elemSize());
+        for(int y(0); y < electrodes.rows; ++y) {
+            memcpy(&m_staging[y * row], electrodes.ptr<uchar>(y), row);
+        }
+        data = m_staging.data();
+    }
+
+    return sendFrame(data, electrodes.cols, electrodes.rows, 8, electrodes.channels());
+}
+
+bool UdpStreamer::sendPacked(uint8_t const* packed, int width, int height, int bits, int channels) {
+    if(m_socket < 0 || (bits != 1 && bits != 2 && bits != 4 && bits != 8) || (channels != 1 && channels != 3)
+       || width <= 0 || height <= 0 || width > m_maxWidth || height > m_maxHeight || channels > m_maxChannels) {
+        return false;
+    }
+
+    return sendFrame(packed, width, height, bits, channels);
+}
+
+bool UdpStreamer::sendFrame(uint8_t const* data, int width, int height, int bits, int channels) {
+    size_t total(udpFrameBytes(width, height, bits, channels));
+    size_t fragments((total + m_payloadSize - 1) / m_payloadSize);
+
+    UdpFrameHeader header;
+    header.frame = ++m_frame;
+    header.timestampNs = monotonicNs();
+    header.width = width;
+    header.height = height;
+    header.fragmentCount = fragments;
+    header.bits = bits;
+    header.channels = channels;
+
+    for(size_t i(0); i < fragments; ++i) {
+        header.fragment = i;
+        header.offset = i * m_payloadSize;
+        header.length = min(static_cast<size_t>(m_payloadSize), total - header.offset);
+        writeUdpFrameHeader(header, &m_headers[i * UDP_FRAME_HEADER_SIZE]);
+
+        m_batch->iov[2 * i + 1].iov_base = const_cast<uint8_t*>(data + header.offset);
+        m_batch->iov[2 * i + 1].iov_len = header.length;
+    }
+
+    size_t sent(0);
+#ifdef __linux__
+    while(sent < fragments) {
+        int count(sendmmsg(m_socket, &m_batch->messages[sent], fragments - sent, MSG_DONTWAIT));
+        if(count < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        sent += count;
+    }
+#else
+    for(; sent < fragments; ++sent) {
+        if(sendmsg(m_socket, &m_batch->messages[sent], MSG_DONTWAIT) < 0) {
+            break;
+        }
+    }
+#endif
+
+    m_dropped += fragments - sent;
+    if(sent == fragments) {
+        ++m_framesSent;
+        return true;
+    }
+    return false;
+}
+
+#else
+
+struct UdpStreamer::Batch {
+};
+
+UdpStreamer::UdpStreamer() : m_socket(-1), m_maxWidth(0), m_maxHeight(0), m_payloadSize(0), m_maxChannels(0),
+                             m_frame(0), m_framesSent(0), m_dropped(0) {
+}
+
+UdpStreamer::~UdpStreamer() {
+}
+
+bool UdpStreamer::open(string const& host, int port, int, int, int, int) {
+    cout << "UDP : streaming is only available on POSIX systems, " << host << ":" << port << " not used" << endl;
+    return false;
+}
+
+void UdpStreamer::close() {
+}
+
+bool UdpStreamer::send(Mat const&) {
+    return false;
+}
+
+bool UdpStreamer::sendPacked(uint8_t const*, int, int, int, int) {
+    return false;
+}
+
+#endif
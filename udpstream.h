@@ -0,0 +1,78 @@
+#ifndef UDPSTREAM_H_INCLUDED
+#define UDPSTREAM_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//Electrode frames sent over UDP to the stimulator.
+//
+//A frame is cut in fragments of at most 'payloadSize' bytes. The electrodes take one byte each (three for the
+//BGR electrodes, B then G then R), or are packed 8 / bits values per byte (see packLevels()), row after row.
+//Every datagram starts with a UDP_FRAME_HEADER_SIZE bytes header, all fields in network byte order :
+//  magic (4) | frame (4) | timestamp ns (8) | width (2) | height (2)
+//  | fragment (2) | fragment count (2) | offset in the frame (4) | length (2) | bits (1, 0 for 8) | channels (1, 0 for 1)
+
+const uint32_t UDP_FRAME_MAGIC = 0x45594542; //"BEYE"
+const size_t UDP_FRAME_HEADER_SIZE = 32;
+const int UDP_DEFAULT_PORT = 5005;
+
+struct UdpFrameHeader {
+    uint32_t frame;
+    uint64_t timestampNs;
+    uint16_t width;
+    uint16_t height;
+    uint16_t fragment;
+    uint16_t fragmentCount;
+    uint32_t offset;
+    uint16_t length;
+    uint8_t bits;     //Per value
+    uint8_t channels; //Values per electrode, 1 or 3
+};
+
+void writeUdpFrameHeader(UdpFrameHeader const& header, uint8_t* out);
+bool readUdpFrameHeader(uint8_t const* in, size_t size, UdpFrameHeader& header);
+size_t udpFrameBytes(int width, int height, int bits, int channels = 1);
+
+class UdpStreamer {
+public:
+    UdpStreamer();
+    ~UdpStreamer();
+
+    //Everything needed for a maxWidth * maxHeight frame is allocated here, send() allocates nothing
+    bool open(std::string const& host, int port, int maxWidth, int maxHeight, int payloadSize = 1400, int maxChannels = 1);
+    void close();
+    bool isOpen() const { return m_socket >= 0; }
+
+    //Never blocks : when the socket buffer is full the rest of the frame is dropped.
+    //CV_8UC1 or CV_8UC3 electrodes.
+    bool send(cv::Mat const& electrodes);
+    //Same for levels packed with packLevels(), 1, 2, 4 or 8 bits per value
+    bool sendPacked(uint8_t const* packed, int width, int height, int bits, int channels = 1);
+
+    unsigned int framesSent() const { return m_framesSent; }
+    unsigned int datagramsDropped() const { return m_dropped; }
+
+private:
+    UdpStreamer(UdpStreamer const&);
+    UdpStreamer& operator=(UdpStreamer const&);
+
+    bool sendFrame(uint8_t const* data, int width, int height, int bits, int channels);
+
+    int m_socket;
+    int m_maxWidth, m_maxHeight, m_payloadSize, m_maxChannels;
+    uint32_t m_frame;
+    unsigned int m_framesSent, m_dropped;
+
+    std::vector<uint8_t> m_headers; //One header per fragment
+    std::vector<uint8_t> m_staging; //Only used when the frame is not continuous
+
+    struct Batch; //mmsghdr and iovec arrays, kept out of this header
+    std::unique_ptr<Batch> m_batch;
+};
+
+#endif // UDPSTREAM_H_INCLUDED